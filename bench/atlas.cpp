@@ -0,0 +1,44 @@
+// atlas packing needs the gfx sources, so it is only built with ARC_BENCH_GFX (cmake -DARC_BENCH_GFX=ON).
+// #atlas::begin makes a gl texture, so the cases drive the skyline and the blit directly.
+#ifdef ARC_BENCH_GFX
+#include <algorithm>
+#include <bench.h>
+#include <gfx/atlas.h>
+#include <random>
+
+using namespace arc;
+using namespace arc::bench;
+using namespace arc::gfx;
+
+static std::vector<std::pair<int, int>> P_make_sprite_sizes(int n)
+{
+    std::mt19937 rng(42);
+    std::vector<std::pair<int, int>> sizes;
+    for (int i = 0; i < n; i++)
+        sizes.emplace_back(8 + static_cast<int>(rng() % 56), 8 + static_cast<int>(rng() % 56));
+    // the order #atlas::accept_all packs in.
+    std::stable_sort(sizes.begin(), sizes.end(), [](const auto &a, const auto &b) {
+        return a.second != b.second ? a.second > b.second : a.first > b.first;
+    });
+    return sizes;
+}
+
+ARC_BENCH(atlas_pack)
+{
+    std::vector<std::pair<int, int>> sizes = P_make_sprite_sizes(4000);
+    bench_run("atlas skyline (4000 sprites, 4k)", 0, [&]() {
+        std::vector<P_skyline_node> sky{{0, 0, 4096}};
+        int x, y, placed = 0;
+        for (const auto &[w, h] : sizes)
+            placed += P_skyline_insert(sky, w + 1, h + 1, 4096, 4096, x, y);
+        bench_keep(placed);
+    });
+}
+
+ARC_BENCH(atlas_imgcpy)
+{
+    atlas at(1024, 1024);
+    std::shared_ptr<image> img = image::make(64, 64, new uint8_t[64 * 64 * 4]());
+    bench_run("atlas::imgcpy (64x64)", 64 * 64 * 4, [&]() { at.imgcpy(img, 17, 33); });
+}
+#endif
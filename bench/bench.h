@@ -0,0 +1,50 @@
+#pragma once
+#include <core/def.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace arc::bench
+{
+
+struct bench_result
+{
+    std::string name;
+    long iterations = 0;
+    double ns_per_op = 0;
+    // throughput, only meaningful when the case processes bytes.
+    double mb_per_s = 0;
+};
+
+// run #fn repeatedly for at least #min_sec seconds, print the result and keep it for the json report.
+// #bytes is the payload processed per call, 0 if not applicable.
+bench_result bench_run(const std::string &name, size_t bytes, const std::function<void()> &fn, double min_sec = 0.5);
+
+// keep a value alive so that the optimizer cannot drop the code producing it.
+template <typename T> void bench_keep(T &&v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&v) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &v;
+#endif
+}
+
+struct P_bench_case
+{
+    const char *name;
+    std::function<void()> fn;
+};
+
+std::vector<P_bench_case> &P_get_bench_cases();
+std::vector<bench_result> &P_get_bench_results();
+
+} // namespace arc::bench
+
+// declare a benchmark case, it is registered before main runs.
+// the case name is what the command line filter matches.
+#define ARC_BENCH(fn)                                                                                                  \
+    static void fn();                                                                                                  \
+    static bool P_bench_reg_##fn = (arc::bench::P_get_bench_cases().push_back({#fn, fn}), true);                       \
+    static void fn()
@@ -0,0 +1,68 @@
+#include <bench.h>
+#include <core/bin.h>
+#include <core/bio.h>
+
+using namespace arc;
+using namespace arc::bench;
+
+// a chunk-like document: many small scalars and strings, a few nested maps and arrays.
+static binary_map P_make_doc()
+{
+    binary_map doc;
+    for (int i = 0; i < 256; i++)
+    {
+        binary_map ent;
+        ent["id"] = i;
+        ent["x"] = i * 0.5;
+        ent["y"] = static_cast<float>(i) * 2.0f;
+        ent["alive"] = (i % 3) != 0;
+        ent["name"] = "entity_" + std::to_string(i);
+        ent["desc"] = std::string(48, static_cast<char>('a' + i % 26));
+
+        binary_array inv;
+        for (int j = 0; j < 8; j++)
+            inv.push(j * i);
+        ent["inventory"] = inv;
+
+        doc["e" + std::to_string(i)] = ent;
+    }
+    return doc;
+}
+
+ARC_BENCH(bio_encode)
+{
+    binary_map doc = P_make_doc();
+    size_t bytes = bio_write_buf(doc).size();
+    bench_run("bio_write_buf", bytes, [&]() { bench_keep(bio_write_buf(doc)); });
+}
+
+ARC_BENCH(bio_decode)
+{
+    byte_buf buf = bio_write_buf(P_make_doc());
+    bench_run("bio_read_buf", buf.size(), [&]() {
+        buf.rewind();
+        bench_keep(bio_read_buf(buf));
+    });
+}
+
+ARC_BENCH(bio_access)
+{
+    binary_map doc = P_make_doc();
+    bench_run("binary_map::get (nested)", 0, [&]() {
+        long sum = 0;
+        for (int i = 0; i < 256; i += 17)
+            sum += doc.get<binary_map>("e" + std::to_string(i)).get<int>("id");
+        bench_keep(sum);
+    });
+}
+
+ARC_BENCH(bio_find)
+{
+    binary_map doc = P_make_doc();
+    bench_run("binary_map::find (nested)", 0, [&]() {
+        long sum = 0;
+        for (int i = 0; i < 256; i += 17)
+            sum += doc.find("e" + std::to_string(i))->as_map().get<int>("id");
+        bench_keep(sum);
+    });
+}
@@ -0,0 +1,60 @@
+#include <bench.h>
+#include <core/buffer.h>
+
+using namespace arc;
+using namespace arc::bench;
+
+ARC_BENCH(buffer_write)
+{
+    byte_buf buf(1 << 16);
+    bench_run("byte_buf::write (4k scalars)", 4096 * 8, [&]() {
+        buf.clear();
+        for (int i = 0; i < 1024; i++)
+        {
+            buf.write<int>(i);
+            buf.write<float>(i * 0.5f);
+            buf.write<double>(i * 0.25);
+            buf.write<bool>(i & 1);
+        }
+        bench_keep(buf);
+    });
+}
+
+ARC_BENCH(buffer_read)
+{
+    byte_buf buf(1 << 16);
+    for (int i = 0; i < 1024; i++)
+    {
+        buf.write<int>(i);
+        buf.write<float>(i * 0.5f);
+        buf.write<double>(i * 0.25);
+        buf.write<bool>(i & 1);
+    }
+    bench_run("byte_buf::read (4k scalars)", buf.size(), [&]() {
+        buf.rewind();
+        double sum = 0;
+        for (int i = 0; i < 1024; i++)
+        {
+            sum += buf.read<int>();
+            sum += buf.read<float>();
+            sum += buf.read<double>();
+            sum += buf.read<bool>();
+        }
+        bench_keep(sum);
+    });
+}
+
+ARC_BENCH(buffer_string)
+{
+    byte_buf buf(1 << 16);
+    std::string str(24, 'x');
+    bench_run("byte_buf::write/read_string", 256 * str.size(), [&]() {
+        buf.clear();
+        for (int i = 0; i < 256; i++)
+            buf.write_string(str);
+        size_t n = 0;
+        for (int i = 0; i < 256; i++)
+            n += buf.read_string().size();
+        bench_keep(n);
+    });
+}
@@ -0,0 +1,71 @@
+#include <bench.h>
+#include <core/ecs.h>
+
+using namespace arc;
+using namespace arc::bench;
+
+struct P_bench_position
+{
+    double x = 0;
+    double y = 0;
+
+    void write(byte_buf &buf)
+    {
+        buf.write<double>(x);
+        buf.write<double>(y);
+    }
+
+    void read(byte_buf &buf)
+    {
+        x = buf.read<double>();
+        y = buf.read<double>();
+    }
+};
+
+constexpr static int P_ECS_COUNT = 10000;
+
+static std::vector<entity_ref> P_make_refs()
+{
+    std::vector<entity_ref> refs;
+    for (int i = 0; i < P_ECS_COUNT; i++)
+        refs.push_back(uuid::make());
+    return refs;
+}
+
+ARC_BENCH(ecs_pool_add_remove)
+{
+    std::vector<entity_ref> refs = P_make_refs();
+    ecs_pool<P_bench_position> pool;
+    bench_run("ecs_pool add+remove (10k)", 0, [&]() {
+        for (const entity_ref &e : refs)
+            pool.add(e, {1, 2});
+        for (const entity_ref &e : refs)
+            pool.remove(e);
+    });
+}
+
+ARC_BENCH(ecs_pool_get)
+{
+    std::vector<entity_ref> refs = P_make_refs();
+    ecs_pool<P_bench_position> pool;
+    for (const entity_ref &e : refs)
+        pool.add(e, {1, 2});
+    bench_run("ecs_pool get (10k)", 0, [&]() {
+        double sum = 0;
+        for (const entity_ref &e : refs)
+            sum += pool.get(e)->x;
+        bench_keep(sum);
+    });
+}
+
+ARC_BENCH(ecs_pool_each)
+{
+    std::vector<entity_ref> refs = P_make_refs();
+    ecs_pool<P_bench_position> pool;
+    for (const entity_ref &e : refs)
+        pool.add(e, {1, 2});
+    bench_run("ecs_pool each (10k)", 0, [&]() {
+        pool.each([](const entity_ref &, P_bench_position &p) { p.x += p.y; });
+        bench_keep(pool.data);
+    });
+}
@@ -0,0 +1,43 @@
+// font layout needs the gfx sources, so it is only built with ARC_BENCH_GFX (cmake -DARC_BENCH_GFX=ON).
+// the glyphs are synthetic and the brush is null, so no window, gl context or font file is involved.
+#ifdef ARC_BENCH_GFX
+#include <bench.h>
+#include <gfx/font.h>
+
+using namespace arc;
+using namespace arc::bench;
+using namespace arc::gfx;
+
+static std::shared_ptr<font> P_make_font()
+{
+    std::shared_ptr<font> fnt = std::make_shared<font>();
+    fnt->height = 16;
+    fnt->lspc = 18;
+    fnt->ascend = 12;
+    fnt->descend = 4;
+    // a glyph without a texture counts as not made yet. this one is never freed, since freeing calls into gl.
+    std::shared_ptr<texture> tex(new texture(), [](texture *) {});
+    fnt->P_bmp[0] = std::make_unique<glyph[]>(256);
+    for (char32_t ch = 32; ch < 127; ch++)
+        fnt->P_bmp[0][ch] = {tex, vec2(7, 12), 8, vec2(0, -4)};
+    return fnt;
+}
+
+ARC_BENCH(font_layout)
+{
+    std::shared_ptr<font> fnt = P_make_font();
+    std::string text = "The quick brown fox jumps over the lazy dog. 0123456789 [DEBUG FPS: 60]";
+    bench_run("font::make_vtx (null brush)", 0, [&]() { bench_keep(fnt->make_vtx(nullptr, text, 0, 0)); });
+}
+
+ARC_BENCH(font_layout_wrapped)
+{
+    std::shared_ptr<font> fnt = P_make_font();
+    std::string text;
+    for (int i = 0; i < 8; i++)
+        text += "a paragraph that wraps around a narrow text view, ";
+    bench_run("font::make_vtx (wrapped, centered)", 0, [&]() {
+        bench_keep(fnt->make_vtx(nullptr, text, 0, 0, font_align::NORMAL_CENTER, 240));
+    });
+}
+#endif
@@ -0,0 +1,47 @@
+#include <bench.h>
+#include <core/io.h>
+#include <core/rand.h>
+
+using namespace arc;
+using namespace arc::bench;
+
+// 256 KiB that compresses about as well as chunk data: long runs with some noise.
+static std::vector<uint8_t> P_make_payload()
+{
+    std::vector<uint8_t> data(256 * 1024);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        data[i] = (state >> 28) == 0 ? static_cast<uint8_t>(state >> 20) : static_cast<uint8_t>(i / 64);
+    }
+    return data;
+}
+
+static void P_bench_compress(const char *name, io_compression_level lvl)
+{
+    std::vector<uint8_t> data = P_make_payload();
+    bench_run(name, data.size(), [&]() { bench_keep(io_compress(data, lvl)); }, 1.0);
+}
+
+ARC_BENCH(io_compress_fastest)
+{
+    P_bench_compress("io_compress FASTEST", io_compression_level::FASTEST);
+}
+
+ARC_BENCH(io_compress_optimal)
+{
+    P_bench_compress("io_compress OPTIMAL", io_compression_level::OPTIMAL);
+}
+
+ARC_BENCH(io_compress_smallest)
+{
+    P_bench_compress("io_compress SMALLEST", io_compression_level::SMALLEST);
+}
+
+ARC_BENCH(io_decompress_optimal)
+{
+    std::vector<uint8_t> data = P_make_payload();
+    std::vector<uint8_t> packed = io_compress(data, io_compression_level::OPTIMAL);
+    bench_run("io_decompress", data.size(), [&]() { bench_keep(io_decompress(packed)); });
+}
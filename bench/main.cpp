@@ -0,0 +1,123 @@
+#include <bench.h>
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+
+namespace arc::bench
+{
+
+std::vector<P_bench_case> &P_get_bench_cases()
+{
+    static std::vector<P_bench_case> cases;
+    return cases;
+}
+
+std::vector<bench_result> &P_get_bench_results()
+{
+    static std::vector<bench_result> results;
+    return results;
+}
+
+bench_result bench_run(const std::string &name, size_t bytes, const std::function<void()> &fn, double min_sec)
+{
+    using clk = std::chrono::steady_clock;
+
+    // warm up the caches and the allocator.
+    fn();
+
+    long iters = 0;
+    long batch = 1;
+    auto start = clk::now();
+    double elapsed = 0;
+    while (elapsed < min_sec)
+    {
+        for (long i = 0; i < batch; i++)
+            fn();
+        iters += batch;
+        batch *= 2;
+        elapsed = std::chrono::duration<double>(clk::now() - start).count();
+    }
+
+    bench_result r;
+    r.name = name;
+    r.iterations = iters;
+    r.ns_per_op = elapsed * 1e9 / iters;
+    r.mb_per_s = bytes > 0 ? (static_cast<double>(bytes) * iters / (1024.0 * 1024.0)) / elapsed : 0;
+
+    if (bytes > 0)
+        fmt::print("{:<32} {:>12.1f} ns/op {:>10.1f} MB/s\n", r.name, r.ns_per_op, r.mb_per_s);
+    else
+        fmt::print("{:<32} {:>12.1f} ns/op\n", r.name, r.ns_per_op);
+    P_get_bench_results().push_back(r);
+    return r;
+}
+
+static std::string P_json_escape(const std::string &str)
+{
+    std::string out;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// one object per result, in the order they ran. the names are stable, so results can be diffed across commits.
+static bool P_write_json(const std::string &path)
+{
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+    fmt::format_to(out, "{{\n  \"results\": [");
+    const auto &results = P_get_bench_results();
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result &r = results[i];
+        fmt::format_to(out, "{}\n    {{\"name\": \"{}\", \"iterations\": {}, \"ns_per_op\": {:.3f}, \"mb_per_s\": {:.3f}}}",
+                       i == 0 ? "" : ",", P_json_escape(r.name), r.iterations, r.ns_per_op, r.mb_per_s);
+    }
+    fmt::format_to(out, "\n  ]\n}}\n");
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    return true;
+}
+
+} // namespace arc::bench
+
+// usage: arcaie-bench [--json <file>] [filter...]
+// a case runs if its name contains any of the filters, or if there is no filter.
+int main(int argc, char **argv)
+{
+    using namespace arc::bench;
+
+    std::string json_path;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_path = argv[++i];
+        else
+            filters.emplace_back(argv[i]);
+    }
+
+    for (auto &c : P_get_bench_cases())
+    {
+        bool run = filters.empty();
+        for (const std::string &f : filters)
+            run = run || std::string(c.name).find(f) != std::string::npos;
+        if (run)
+            c.fn();
+    }
+
+    if (!json_path.empty() && !P_write_json(json_path))
+    {
+        fmt::print("cannot write {}\n", json_path);
+        return 1;
+    }
+    return 0;
+}
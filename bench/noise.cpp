@@ -0,0 +1,26 @@
+#include <bench.h>
+#include <core/rand.h>
+
+using namespace arc;
+using namespace arc::bench;
+
+static void P_bench_noise(const char *name, std::shared_ptr<noise> n)
+{
+    bench_run(name, 0, [&]() {
+        double sum = 0;
+        for (int y = 0; y < 32; y++)
+            for (int x = 0; x < 32; x++)
+                sum += n->generate(x * 0.1, y * 0.1, 0.5);
+        bench_keep(sum);
+    });
+}
+
+ARC_BENCH(noise_perlin)
+{
+    P_bench_noise("noise perlin (32x32)", noise::make_perlin(42));
+}
+
+ARC_BENCH(noise_voronoi)
+{
+    P_bench_noise("noise voronoi (32x32)", noise::make_voronoi(42));
+}
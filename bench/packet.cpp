@@ -0,0 +1,31 @@
+#include <bench.h>
+#include <net/packet.h>
+
+using namespace arc;
+using namespace arc::bench;
+using namespace arc::net;
+
+static void P_mark_packets()
+{
+    static bool marked = (packet::mark_id<packet_dummy>(), true);
+    bench_keep(marked);
+}
+
+ARC_BENCH(packet_pack)
+{
+    P_mark_packets();
+    std::shared_ptr<packet> p = packet::make<packet_dummy>(std::string(200, 'p'));
+    bench_run("packet::pack", 200, [&]() { bench_keep(packet::pack(p)); });
+}
+
+ARC_BENCH(packet_unpack)
+{
+    P_mark_packets();
+    byte_buf buf(packet::pack(packet::make<packet_dummy>(std::string(200, 'p'))));
+    int len = buf.read<int>();
+    size_t pos = buf.read_pos();
+    bench_run("packet::unpack", 200, [&]() {
+        buf.set_read_pos(pos);
+        bench_keep(packet::unpack(buf, len));
+    });
+}
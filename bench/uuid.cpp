@@ -0,0 +1,25 @@
+#include <bench.h>
+#include <core/uuid.h>
+#include <unordered_set>
+
+using namespace arc;
+using namespace arc::bench;
+
+ARC_BENCH(uuid_make)
+{
+    bench_run("uuid::make", 0, []() { bench_keep(uuid::make()); });
+}
+
+ARC_BENCH(uuid_hash)
+{
+    std::vector<uuid> ids;
+    for (int i = 0; i < 4096; i++)
+        ids.push_back(uuid::make());
+    std::unordered_set<uuid> set(ids.begin(), ids.end());
+    bench_run("uuid hash lookup (4k)", 0, [&]() {
+        size_t n = 0;
+        for (const uuid &id : ids)
+            n += set.count(id);
+        bench_keep(n);
+    });
+}
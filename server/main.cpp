@@ -0,0 +1,96 @@
+#include <atomic>
+#include <core/io.h>
+#include <core/log.h>
+#include <core/prof.h>
+#include <core/time.h>
+#include <csignal>
+#include <cstring>
+#include <lua/lua.h>
+#include <net/packet.h>
+#include <net/socket.h>
+#include <string>
+#include <world/level.h>
+
+using namespace arc;
+using namespace arc::net;
+using namespace arc::lua;
+using namespace arc::world;
+
+// the dedicated server: the tick loop of the game without a window, gl or al.
+// usage: arcaie-server [port] [tps]
+
+static std::atomic<bool> P_stop_requested = false;
+
+static void P_on_signal(int)
+{
+    P_stop_requested = true;
+}
+
+// the argument as an integer in [#min, #max], or #def if it is absent. false if it is not one.
+static bool P_parse_arg(int argc, char **argv, int i, int min, int max, int def, int &out)
+{
+    out = def;
+    if (argc <= i)
+        return true;
+    try
+    {
+        size_t end = 0;
+        out = std::stoi(argv[i], &end);
+        return end == std::strlen(argv[i]) && out >= min && out <= max;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int port_arg, tps;
+    if (argc > 3 || !P_parse_arg(argc, argv, 1, 0, 65535, 0, port_arg) || !P_parse_arg(argc, argv, 2, 1, 1000, 20, tps))
+    {
+        print(ARC_FATAL, "usage: arcaie-server [port] [tps], with the port in [0, 65535], 0 for any free port, "
+                         "and the tps in [1, 1000].");
+        log_flush();
+        return 1;
+    }
+    uint16_t port = static_cast<uint16_t>(port_arg);
+
+    std::signal(SIGINT, P_on_signal);
+    std::signal(SIGTERM, P_on_signal);
+
+    level lvl;
+    socket &socks = socket::server();
+
+    lua_make_state();
+    lua_bind_modules();
+    path_handle script = io_open_local("server.lua");
+    if (io_exists(script))
+        lua_eval(io_read_str(script));
+
+    packet::mark_id<packet_2s_heartbeat>();
+    packet::mark_id<packet_dummy>();
+
+    if (port == 0)
+        port = P_gen_tcp_port();
+    socks.start(port);
+    print(ARC_INFO, "the server is running on port {} at {} tps.", port, tps);
+
+    lua_function tick_fn = lua_get<lua_function>("tick");
+    tick_lifecycle(
+        tps,
+        [&]() {
+            lvl.tick_systems();
+            if (tick_fn.valid())
+                lua_protected_call(tick_fn, &lvl);
+            socks.tick();
+        },
+        []() { return P_stop_requested.load(); });
+
+    print(ARC_INFO, "stopping the server.");
+    socks.stop();
+#ifdef ARC_PROFILE
+    prof_export(io_open_local("trace.json"));
+#endif
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <al/al.h>
 #include <al/alc.h>
 #include <audio/device.h>
+#include <core/load.h>
 #include <core/log.h>
 #include <gfx/device.h>
 
@@ -22,13 +23,47 @@ track::~track()
     alDeleteBuffers(1, &P_track_id);
 }
 
-extern std::shared_ptr<track> P_wav_load(const path_handle &path);
+extern std::shared_ptr<track_data> P_wav_decode(const std::vector<uint8_t> &file, const std::string &name);
 
 std::shared_ptr<track> track::load(const path_handle &path)
 {
-    return P_wav_load(path);
+    return make(decode(path));
 }
 
+std::shared_ptr<track_data> track::decode(const path_handle &path)
+{
+    return P_wav_decode(io_read_bytes(path), path.abs_path);
+}
+
+std::shared_ptr<track_data> track::decode(const std::vector<uint8_t> &file, const std::string &name)
+{
+    return P_wav_decode(file, name);
+}
+
+std::shared_ptr<track> track::make(std::shared_ptr<track_data> data)
+{
+    ALuint buffer;
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, data->P_format, data->samples.data(), data->samples.size(), data->sample_rate);
+
+    std::shared_ptr<track> ptr = std::make_shared<track>();
+    ptr->P_track_id = buffer;
+    ptr->sec_len = static_cast<double>(data->samples.size()) / (data->sample_rate * data->bits / 8.0) / data->channels;
+    return ptr;
+}
+
+// this unit is linked whenever tracks are used, so the equipment is always there with them.
+static bool P_audio_equips_registered = []() {
+    asset_equip_register(asset_loader_equip::WAVE, [](asset_loader &loader) {
+        loader.async_strategy_map[".wav"] = [](const asset_source &src,
+                                               const unique_id &id) -> std::function<void()> {
+            std::shared_ptr<track_data> data = track::decode(src.read_bytes(), src.path.abs_path);
+            return [data, id]() { res_put(id, track::make(data)); };
+        };
+    });
+    return true;
+}();
+
 clip::~clip()
 {
     alDeleteSources(1, &P_clip_id);
@@ -3,10 +3,22 @@
 #include <memory>
 #include <core/math.h>
 #include <core/io.h>
+#include <vector>
 
 namespace arc::audio
 {
 
+// decoded pcm samples, which are not uploaded to openal yet.
+// decoding does not touch openal, so it can happen on any thread.
+struct track_data
+{
+    std::vector<uint8_t> samples;
+    /* unstable */ int P_format = 0;
+    int sample_rate = 0;
+    int bits = 0;
+    int channels = 0;
+};
+
 struct track
 {
     /* unstable */ unsigned int P_track_id;
@@ -15,6 +27,11 @@ struct track
     ~track();
 
     static std::shared_ptr<track> load(const path_handle &path);
+    static std::shared_ptr<track_data> decode(const path_handle &path);
+    // decode a wave file in memory. #name is only used in error messages.
+    static std::shared_ptr<track_data> decode(const std::vector<uint8_t> &file, const std::string &name);
+    // upload the decoded samples, this should be called on the main thread.
+    static std::shared_ptr<track> make(std::shared_ptr<track_data> data);
 };
 
 enum class device_option
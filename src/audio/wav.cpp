@@ -6,31 +6,26 @@
 namespace arc::audio
 {
 
-std::shared_ptr<track> P_wav_load(const path_handle &path)
+std::shared_ptr<track_data> P_wav_decode(const std::vector<uint8_t> &file, const std::string &name)
 {
-    auto file = io_read_bytes(path);
-
     size_t index = 0;
 
     if (file.size() < 12)
-        print_throw(ARC_FATAL, "too small file: {}", path.abs_path);
+        print_throw(ARC_FATAL, "too small file: {}", name);
 
     if (file[index++] != 'R' || file[index++] != 'I' || file[index++] != 'F' || file[index++] != 'F')
-        print_throw(ARC_FATAL, "not a wave file: {}", path.abs_path);
+        print_throw(ARC_FATAL, "not a wave file: {}", name);
 
     index += 4;
 
     if (file[index++] != 'W' || file[index++] != 'A' || file[index++] != 'V' || file[index++] != 'E')
-        print_throw(ARC_FATAL, "not a wave file: {}", path.abs_path);
+        print_throw(ARC_FATAL, "not a wave file: {}", name);
 
     int samp_rate = 0;
     int16_t bps = 0;
     int16_t n_ch = 0;
-    int byte_size = 0;
     ALenum format = 0;
-
-    ALuint buffer;
-    alGenBuffers(1, &buffer);
+    std::shared_ptr<track_data> data = std::make_shared<track_data>();
 
     while (index + 8 <= file.size())
     {
@@ -44,17 +39,17 @@ std::shared_ptr<track> P_wav_load(const path_handle &path)
         index += 4;
 
         if (index + chunk_size > file.size())
-            print_throw(ARC_FATAL, "invalid chunk size: {}", path.abs_path);
+            print_throw(ARC_FATAL, "invalid chunk size: {}", name);
 
         if (identifier == "fmt ")
         {
             if (chunk_size != 16)
-                print_throw(ARC_FATAL, "unknown format: {}", path.abs_path);
+                print_throw(ARC_FATAL, "unknown format: {}", name);
 
             int16_t audio_format = *reinterpret_cast<const int16_t *>(&file[index]);
             index += 2;
             if (audio_format != 1)
-                print_throw(ARC_FATAL, "unknown format: {}", path.abs_path);
+                print_throw(ARC_FATAL, "unknown format: {}", name);
 
             n_ch = *reinterpret_cast<const int16_t *>(&file[index]);
             index += 2;
@@ -72,7 +67,7 @@ std::shared_ptr<track> P_wav_load(const path_handle &path)
                 else if (bps == 16)
                     format = AL_FORMAT_MONO16;
                 else
-                    print_throw(ARC_FATAL, "can't play mono " + std::to_string(bps) + " sound.");
+                    print_throw(ARC_FATAL, "can't play mono {} sound.", bps);
             }
             else if (n_ch == 2)
             {
@@ -81,16 +76,14 @@ std::shared_ptr<track> P_wav_load(const path_handle &path)
                 else if (bps == 16)
                     format = AL_FORMAT_STEREO16;
                 else
-                    print_throw(ARC_FATAL, "can't play stereo " + std::to_string(bps) + " sound.");
+                    print_throw(ARC_FATAL, "can't play stereo {} sound.", bps);
             }
             else
-                print_throw(ARC_FATAL, "can't play audio with " + std::to_string(n_ch) + " channels");
+                print_throw(ARC_FATAL, "can't play audio with {} channels", n_ch);
         }
         else if (identifier == "data")
         {
-            byte_size = chunk_size;
-            const uint8_t *data = &file[index];
-            alBufferData(buffer, format, data, chunk_size, samp_rate);
+            data->samples.assign(file.begin() + index, file.begin() + index + chunk_size);
             index += chunk_size;
         }
         else if (identifier == "JUNK" || identifier == "iXML")
@@ -99,11 +92,12 @@ std::shared_ptr<track> P_wav_load(const path_handle &path)
             index += chunk_size;
     }
 
-    std::shared_ptr<track> ptr = std::make_shared<track>();
-    ptr->P_track_id = buffer;
-    ptr->sec_len = static_cast<double>(byte_size) / (samp_rate * bps / 8.0) / n_ch;
+    data->P_format = format;
+    data->sample_rate = samp_rate;
+    data->bits = bps;
+    data->channels = n_ch;
 
-    return ptr;
+    return data;
 }
 
 } // namespace arc::audio
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <core/aio.h>
+#include <core/log.h>
+#include <core/pool.h>
+#include <fmt/format.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace arc
+{
+
+struct P_aio_path
+{
+    // the latest sequence submitted to / written to the path.
+    uint64_t submitted = 0;
+    uint64_t written = 0;
+    // the jobs queued or running for the path. the entry is dropped when none are left.
+    int jobs = 0;
+};
+
+struct P_aio_state
+{
+    std::mutex mutex;
+    uint64_t seq = 0;
+    std::unordered_map<std::string, P_aio_path> paths;
+    // declared last, so it is destroyed (and joined) first.
+    std::shared_ptr<thread_pool> pool = thread_pool::make(2);
+};
+
+static P_aio_state &P_get_aio_state()
+{
+    static P_aio_state state;
+    return state;
+}
+
+static void P_aio_write(P_aio_state &st, const path_handle &path, std::vector<uint8_t> data, io_compression_level clvl,
+                        uint64_t seq)
+{
+    {
+        // a newer snapshot is queued, no need to compress this one.
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (st.paths[path.abs_path].submitted != seq)
+            return;
+    }
+
+    std::vector<uint8_t> out = io_compress(std::move(data), clvl);
+    path_handle tmp = io_open(fmt::format("{}.{}.tmp", path.abs_path, seq));
+    io_write_bytes(tmp, out);
+    // the data must be on the disk before the rename, or a crash may leave the target empty or torn.
+    if (!io_sync(tmp))
+    {
+        io_del(tmp);
+        print_throw(ARC_FATAL, "cannot flush {} to the disk.", tmp.abs_path);
+    }
+
+    std::lock_guard<std::mutex> lock(st.mutex);
+    uint64_t &last = st.paths[path.abs_path].written;
+    if (seq < last)
+    {
+        // a newer snapshot has already landed.
+        io_del(tmp);
+        return;
+    }
+    io_rename(tmp, path.abs_path);
+    last = seq;
+    // make the rename itself durable. not every file system can sync a directory, and the data is safe either way.
+    io_sync(io_parent(path));
+}
+
+static void P_aio_done(P_aio_state &st, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(st.mutex);
+    auto it = st.paths.find(path);
+    if (--it->second.jobs == 0)
+        st.paths.erase(it);
+}
+
+std::future<void> aio_write_bytes(const path_handle &path, std::vector<uint8_t> data, io_compression_level clvl)
+{
+    P_aio_state &st = P_get_aio_state();
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        seq = ++st.seq;
+        P_aio_path &p = st.paths[path.abs_path];
+        p.submitted = seq;
+        p.jobs++;
+    }
+
+    return st.pool->submit([&st, path, data = std::move(data), clvl, seq]() mutable {
+        try
+        {
+            P_aio_write(st, path, std::move(data), clvl, seq);
+        }
+        catch (...)
+        {
+            P_aio_done(st, path.abs_path);
+            throw;
+        }
+        P_aio_done(st, path.abs_path);
+    });
+}
+
+std::future<void> aio_write_str(const path_handle &path, const std::string &text)
+{
+    return aio_write_bytes(path, std::vector<uint8_t>(text.begin(), text.end()));
+}
+
+std::future<void> aio_submit(std::function<void()> job)
+{
+    return P_get_aio_state().pool->submit(std::move(job));
+}
+
+void aio_flush()
+{
+    P_get_aio_state().pool->wait();
+}
+
+size_t aio_pending()
+{
+    return P_get_aio_state().pool->pending();
+}
+
+} // namespace arc
@@ -0,0 +1,28 @@
+#pragma once
+#include <core/def.h>
+#include <core/io.h>
+#include <functional>
+#include <future>
+#include <vector>
+
+namespace arc
+{
+
+// asynchronous file writing, backed by a small worker pool.
+// the data passed in is an immutable snapshot: it is owned by the service from then on,
+// so the caller can keep mutating its live objects.
+// compression and disk writes happen on the workers, and every write is atomic
+// (written to a temporary file, synced to the disk, then renamed onto the target).
+// if a path is written several times before the workers catch up, the latest submission wins.
+
+std::future<void> aio_write_bytes(const path_handle &path, std::vector<uint8_t> data,
+                                  io_compression_level clvl = io_compression_level::NO);
+std::future<void> aio_write_str(const path_handle &path, const std::string &text);
+// run a custom save job (for example, a region chunk write) on the i/o workers.
+std::future<void> aio_submit(std::function<void()> job);
+// block until every submitted job is done. call this before exiting.
+void aio_flush();
+// the count of queued and running jobs.
+size_t aio_pending();
+
+} // namespace arc
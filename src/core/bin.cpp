@@ -0,0 +1,189 @@
+#include <core/bin.h>
+#include <cstring>
+
+namespace arc
+{
+
+binary_value::binary_value() : P_long(0)
+{
+}
+
+binary_value::binary_value(binary_value &&other) noexcept : type(other.type), P_slen(other.P_slen)
+{
+    // every union member lies within the inline string, so copying it takes the whole payload.
+    std::memcpy(P_sso, other.P_sso, sizeof(P_sso));
+    other.type = P_bincvt::MAP_ENDV;
+    other.P_slen = 0;
+}
+
+binary_value &binary_value::operator=(binary_value &&other) noexcept
+{
+    if (this != &other)
+    {
+        P_release();
+        type = other.type;
+        P_slen = other.P_slen;
+        std::memcpy(P_sso, other.P_sso, sizeof(P_sso));
+        other.type = P_bincvt::MAP_ENDV;
+        other.P_slen = 0;
+    }
+    return *this;
+}
+
+binary_value::~binary_value()
+{
+    P_release();
+}
+
+void binary_value::P_release()
+{
+    switch (type)
+    {
+    case P_bincvt::STRING_C:
+        if (P_slen == P_SLEN_HEAP)
+            delete[] P_heap.ptr;
+        break;
+    case P_bincvt::MAP:
+        delete P_map;
+        break;
+    case P_bincvt::ARRAY:
+        delete P_array;
+        break;
+    case P_bincvt::BUF:
+        delete P_buf;
+        break;
+    default:
+        break;
+    }
+    type = P_bincvt::MAP_ENDV;
+    P_slen = 0;
+}
+
+binary_value binary_value::clone() const
+{
+    switch (type)
+    {
+    case P_bincvt::STRING_C:
+        return make_str(as_str());
+    case P_bincvt::MAP:
+        return P_make_map(new binary_map(P_map->clone()));
+    case P_bincvt::ARRAY:
+        return P_make_array(new binary_array(P_array->clone()));
+    case P_bincvt::BUF:
+        return P_make_buf(new byte_buf(*P_buf));
+    default: {
+        // scalars are trivially copyable.
+        binary_value bv;
+        bv.type = type;
+        std::memcpy(bv.P_sso, P_sso, sizeof(P_sso));
+        return bv;
+    }
+    }
+}
+
+std::string_view binary_value::as_str() const
+{
+    if (type != P_bincvt::STRING_C)
+        print_throw(ARC_FATAL, "not a string.");
+    if (P_slen == P_SLEN_HEAP)
+        return std::string_view(P_heap.ptr, P_heap.len);
+    return std::string_view(P_sso, P_slen);
+}
+
+const binary_map &binary_value::as_map() const
+{
+    if (type != P_bincvt::MAP)
+        print_throw(ARC_FATAL, "not a map.");
+    return *P_map;
+}
+
+binary_map &binary_value::as_map()
+{
+    if (type != P_bincvt::MAP)
+        print_throw(ARC_FATAL, "not a map.");
+    return *P_map;
+}
+
+const binary_array &binary_value::as_array() const
+{
+    if (type != P_bincvt::ARRAY)
+        print_throw(ARC_FATAL, "not an array.");
+    return *P_array;
+}
+
+binary_array &binary_value::as_array()
+{
+    if (type != P_bincvt::ARRAY)
+        print_throw(ARC_FATAL, "not an array.");
+    return *P_array;
+}
+
+const byte_buf &binary_value::as_buf() const
+{
+    if (type != P_bincvt::BUF)
+        print_throw(ARC_FATAL, "not a buffer.");
+    return *P_buf;
+}
+
+binary_value binary_value::make_str(std::string_view v)
+{
+    binary_value bv;
+    bv.type = P_bincvt::STRING_C;
+    if (v.size() <= ARC_BIN_SSO_CAP)
+    {
+        bv.P_slen = static_cast<uint8_t>(v.size());
+        std::memcpy(bv.P_sso, v.data(), v.size());
+    }
+    else
+    {
+        bv.P_slen = P_SLEN_HEAP;
+        bv.P_heap.ptr = new char[v.size()];
+        bv.P_heap.len = v.size();
+        std::memcpy(bv.P_heap.ptr, v.data(), v.size());
+    }
+    return bv;
+}
+
+binary_value binary_value::P_make_map(binary_map *ptr)
+{
+    binary_value bv;
+    bv.type = P_bincvt::MAP;
+    bv.P_map = ptr;
+    return bv;
+}
+
+binary_value binary_value::P_make_array(binary_array *ptr)
+{
+    binary_value bv;
+    bv.type = P_bincvt::ARRAY;
+    bv.P_array = ptr;
+    return bv;
+}
+
+binary_value binary_value::P_make_buf(byte_buf *ptr)
+{
+    binary_value bv;
+    bv.type = P_bincvt::BUF;
+    bv.P_buf = ptr;
+    return bv;
+}
+
+binary_map binary_map::clone() const
+{
+    binary_map cpy;
+    cpy.data.reserve(data.size());
+    for (auto &kv : data)
+        cpy.data.emplace(kv.first, kv.second.clone());
+    return cpy;
+}
+
+binary_array binary_array::clone() const
+{
+    binary_array cpy;
+    cpy.data.reserve(data.size());
+    for (auto &v : data)
+        cpy.data.push_back(v.clone());
+    return cpy;
+}
+
+} // namespace arc
@@ -1,13 +1,15 @@
 #pragma once
-#include <any>
 #include <core/buffer.h>
 #include <core/def.h>
 #include <core/io.h>
 #include <core/log.h>
 #include <memory>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+// strings up to this length are stored inside the value, without a heap allocation.
+#define ARC_BIN_SSO_CAP 22
 
 namespace arc
 {
@@ -31,107 +33,69 @@ enum class P_bincvt : uint8_t
     MAP_ENDV
 };
 
+// copy a value, deep-copying the move-only binary containers.
+template <typename T> T P_bin_copy(const T &v)
+{
+    if constexpr (std::is_copy_constructible_v<T>)
+        return v;
+    else
+        return v.clone();
+}
+
+// a tagged union of the binary types.
+// scalars and short strings live inline, long strings and containers are owned through one allocation each.
+// values are move-only: a deep copy has to be asked for by #clone.
 struct binary_value
 {
-    P_bincvt type;
-    std::any P_anyv;
+    P_bincvt type = P_bincvt::MAP_ENDV;
+    // the inline string length, or P_SLEN_HEAP if the string is on the heap.
+    uint8_t P_slen = 0;
+    union {
+        uint8_t P_byte;
+        short P_short;
+        int P_int;
+        long P_long;
+        float P_float;
+        double P_double;
+        bool P_bool;
+        char P_sso[ARC_BIN_SSO_CAP];
+        struct
+        {
+            char *ptr;
+            size_t len;
+        } P_heap;
+        binary_map *P_map;
+        binary_array *P_array;
+        byte_buf *P_buf;
+    };
 
-    template <typename T> static binary_value make(const T &v)
-    {
-        using decay_t = std::decay_t<T>;
-
-        if constexpr (std::is_same_v<uint8_t, decay_t>)
-            return {P_bincvt::BYTE, std::any(v)};
-        else if constexpr (std::is_same_v<short, decay_t>)
-            return {P_bincvt::SHORT, std::any(v)};
-        else if constexpr (std::is_same_v<int, decay_t>)
-            return {P_bincvt::INT, std::any(v)};
-        else if constexpr (std::is_same_v<long, decay_t>)
-            return {P_bincvt::LONG, std::any(v)};
-        else if constexpr (std::is_same_v<float, decay_t>)
-            return {P_bincvt::FLOAT, std::any(v)};
-        else if constexpr (std::is_same_v<double, decay_t>)
-            return {P_bincvt::DOUBLE, std::any(v)};
-        // it's tricky to check string types, so we just check if it's constructible.
-        // I've tried const char* & char[], but they don't cover all cases.
-        else if constexpr (std::is_constructible_v<std::string, decay_t>)
-            return {P_bincvt::STRING_C, std::any(std::string(v))};
-        else if constexpr (std::is_same_v<bool, decay_t>)
-            return {P_bincvt::BOOL, std::any(v)};
-        else if constexpr (std::is_same_v<binary_map, decay_t>)
-            return {P_bincvt::MAP, std::make_any<std::shared_ptr<binary_map>>(std::make_shared<binary_map>(v))};
-        else if constexpr (std::is_same_v<binary_array, decay_t>)
-            return {P_bincvt::ARRAY, std::make_any<std::shared_ptr<binary_array>>(std::make_shared<binary_array>(v))};
-        else if constexpr (std::is_same_v<byte_buf, decay_t>)
-            return {P_bincvt::BUF, std::make_any<std::shared_ptr<byte_buf>>(std::make_shared<byte_buf>(v))};
+    constexpr static uint8_t P_SLEN_HEAP = UINT8_MAX;
 
-        print_throw(ARC_FATAL, "unsupported type.");
-    }
+    binary_value();
+    binary_value(binary_value &&other) noexcept;
+    binary_value &operator=(binary_value &&other) noexcept;
+    binary_value(const binary_value &) = delete;
+    binary_value &operator=(const binary_value &) = delete;
+    ~binary_value();
 
-    template <typename T> T cast() const
-    {
-        switch (type)
-        {
-        case P_bincvt::BYTE:
-            if constexpr (std::is_convertible_v<uint8_t, T>)
-                return static_cast<T>(std::any_cast<uint8_t>(P_anyv));
-            else
-                break;
-        case P_bincvt::SHORT:
-            if constexpr (std::is_convertible_v<short, T>)
-                return static_cast<T>(std::any_cast<short>(P_anyv));
-            else
-                break;
-        case P_bincvt::INT:
-            if constexpr (std::is_convertible_v<int, T>)
-                return static_cast<T>(std::any_cast<int>(P_anyv));
-            else
-                break;
-        case P_bincvt::LONG:
-            if constexpr (std::is_convertible_v<long, T>)
-                return static_cast<T>(std::any_cast<long>(P_anyv));
-            else
-                break;
-        case P_bincvt::FLOAT:
-            if constexpr (std::is_convertible_v<float, T>)
-                return static_cast<T>(std::any_cast<float>(P_anyv));
-            else
-                break;
-        case P_bincvt::DOUBLE:
-            if constexpr (std::is_convertible_v<double, T>)
-                return static_cast<T>(std::any_cast<double>(P_anyv));
-            else
-                break;
-        case P_bincvt::STRING_C:
-            if constexpr (std::is_convertible_v<std::string, T>)
-                return std::any_cast<std::string>(P_anyv);
-            else
-                break;
-        case P_bincvt::BOOL:
-            if constexpr (std::is_convertible_v<bool, T>)
-                return static_cast<T>(std::any_cast<bool>(P_anyv));
-            else
-                break;
-        case P_bincvt::MAP:
-            if constexpr (std::is_convertible_v<binary_map, T>)
-                return *std::any_cast<std::shared_ptr<binary_map>>(P_anyv);
-            else
-                break;
-        case P_bincvt::ARRAY:
-            if constexpr (std::is_convertible_v<binary_array, T>)
-                return *std::any_cast<std::shared_ptr<binary_array>>(P_anyv);
-            else
-                break;
-        case P_bincvt::BUF:
-            if constexpr (std::is_convertible_v<byte_buf, T>)
-                return *std::any_cast<std::shared_ptr<byte_buf>>(P_anyv);
-            else
-                break;
-        default:
-            print_throw(ARC_FATAL, "not convertible.");
-        }
-        return T{};
-    }
+    binary_value clone() const;
+    void P_release();
+
+    // direct accessors, they do not copy. they throw if the type does not match.
+    std::string_view as_str() const;
+    const binary_map &as_map() const;
+    binary_map &as_map();
+    const binary_array &as_array() const;
+    binary_array &as_array();
+    const byte_buf &as_buf() const;
+
+    static binary_value make_str(std::string_view v);
+    static binary_value P_make_map(binary_map *ptr);
+    static binary_value P_make_array(binary_array *ptr);
+    static binary_value P_make_buf(byte_buf *ptr);
+    // rvalue containers are moved in, lvalue ones are deep-copied.
+    template <typename T> static binary_value make(T &&v);
+    template <typename T> T cast() const;
 };
 
 struct binary_map
@@ -155,6 +119,14 @@ struct binary_map
 
     std::unordered_map<std::string, binary_value> data;
 
+    binary_map() = default;
+    binary_map(binary_map &&) noexcept = default;
+    binary_map &operator=(binary_map &&) noexcept = default;
+    binary_map(const binary_map &) = delete;
+    binary_map &operator=(const binary_map &) = delete;
+
+    binary_map clone() const;
+
     size_t size() const
     {
         return data.size();
@@ -164,18 +136,25 @@ struct binary_map
     {
         auto it = data.find(key);
         if (it == data.end())
-            return def;
+            return P_bin_copy(def);
         return it->second.cast<T>();
     }
 
+    // get the value without copying, or nullptr if absent.
+    const binary_value *find(const std::string &key) const
+    {
+        auto it = data.find(key);
+        return it == data.end() ? nullptr : &it->second;
+    }
+
     bool has(const std::string &key)
     {
         return data.find(key) != data.end();
     }
 
-    template <typename T> void set(const std::string &key, const T &val)
+    template <typename T> void set(const std::string &key, T &&val)
     {
-        data[key] = binary_value::make(val);
+        data.insert_or_assign(key, binary_value::make(std::forward<T>(val)));
     }
 
     P_proxy operator[](const std::string &key)
@@ -205,6 +184,14 @@ struct binary_array
 
     std::vector<binary_value> data;
 
+    binary_array() = default;
+    binary_array(binary_array &&) noexcept = default;
+    binary_array &operator=(binary_array &&) noexcept = default;
+    binary_array(const binary_array &) = delete;
+    binary_array &operator=(const binary_array &) = delete;
+
+    binary_array clone() const;
+
     size_t size() const
     {
         return data.size();
@@ -213,18 +200,18 @@ struct binary_array
     template <typename T> T get(int i, const T &def = T()) const
     {
         if (i < 0 || i >= data.size())
-            return def;
+            return P_bin_copy(def);
         return data[i].cast<T>();
     }
 
-    template <typename T> void set(int i, const T &val)
+    template <typename T> void set(int i, T &&val)
     {
-        data[i] = binary_value::make(val);
+        data[i] = binary_value::make(std::forward<T>(val));
     }
 
-    template <typename T> void push(const T &val)
+    template <typename T> void push(T &&val)
     {
-        data.push_back(binary_value::make(val));
+        data.push_back(binary_value::make(std::forward<T>(val)));
     }
 
     P_proxy operator[](int i)
@@ -233,4 +220,115 @@ struct binary_array
     }
 };
 
-} // namespace arc
\ No newline at end of file
+template <typename T> binary_value binary_value::make(T &&v)
+{
+    using decay_t = std::decay_t<T>;
+    // an rvalue container can be moved in, instead of being deep-copied.
+    constexpr bool movable = !std::is_lvalue_reference_v<T>;
+    binary_value bv;
+
+    if constexpr (std::is_same_v<uint8_t, decay_t>)
+        bv.type = P_bincvt::BYTE, bv.P_byte = v;
+    else if constexpr (std::is_same_v<short, decay_t>)
+        bv.type = P_bincvt::SHORT, bv.P_short = v;
+    else if constexpr (std::is_same_v<int, decay_t>)
+        bv.type = P_bincvt::INT, bv.P_int = v;
+    else if constexpr (std::is_same_v<long, decay_t>)
+        bv.type = P_bincvt::LONG, bv.P_long = v;
+    else if constexpr (std::is_same_v<float, decay_t>)
+        bv.type = P_bincvt::FLOAT, bv.P_float = v;
+    else if constexpr (std::is_same_v<double, decay_t>)
+        bv.type = P_bincvt::DOUBLE, bv.P_double = v;
+    // it's tricky to check string types, so we just check if it's constructible.
+    // I've tried const char* & char[], but they don't cover all cases.
+    else if constexpr (std::is_convertible_v<const decay_t &, std::string_view>)
+        return make_str(std::string_view(v));
+    else if constexpr (std::is_constructible_v<std::string, decay_t>)
+        return make_str(std::string(v));
+    else if constexpr (std::is_same_v<bool, decay_t>)
+        bv.type = P_bincvt::BOOL, bv.P_bool = v;
+    else if constexpr (std::is_same_v<binary_map, decay_t> && movable)
+        return P_make_map(new binary_map(std::move(v)));
+    else if constexpr (std::is_same_v<binary_map, decay_t>)
+        return P_make_map(new binary_map(v.clone()));
+    else if constexpr (std::is_same_v<binary_array, decay_t> && movable)
+        return P_make_array(new binary_array(std::move(v)));
+    else if constexpr (std::is_same_v<binary_array, decay_t>)
+        return P_make_array(new binary_array(v.clone()));
+    else if constexpr (std::is_same_v<byte_buf, decay_t>)
+        return P_make_buf(new byte_buf(v));
+    else
+        print_throw(ARC_FATAL, "unsupported type.");
+
+    return bv;
+}
+
+template <typename T> T binary_value::cast() const
+{
+    switch (type)
+    {
+    case P_bincvt::BYTE:
+        if constexpr (std::is_convertible_v<uint8_t, T>)
+            return static_cast<T>(P_byte);
+        else
+            break;
+    case P_bincvt::SHORT:
+        if constexpr (std::is_convertible_v<short, T>)
+            return static_cast<T>(P_short);
+        else
+            break;
+    case P_bincvt::INT:
+        if constexpr (std::is_convertible_v<int, T>)
+            return static_cast<T>(P_int);
+        else
+            break;
+    case P_bincvt::LONG:
+        if constexpr (std::is_convertible_v<long, T>)
+            return static_cast<T>(P_long);
+        else
+            break;
+    case P_bincvt::FLOAT:
+        if constexpr (std::is_convertible_v<float, T>)
+            return static_cast<T>(P_float);
+        else
+            break;
+    case P_bincvt::DOUBLE:
+        if constexpr (std::is_convertible_v<double, T>)
+            return static_cast<T>(P_double);
+        else
+            break;
+    case P_bincvt::STRING_C:
+        // a view would dangle if it went through a temporary string.
+        if constexpr (std::is_same_v<std::string_view, T>)
+            return as_str();
+        else if constexpr (std::is_convertible_v<std::string, T>)
+            return std::string(as_str());
+        else
+            break;
+    case P_bincvt::BOOL:
+        if constexpr (std::is_convertible_v<bool, T>)
+            return static_cast<T>(P_bool);
+        else
+            break;
+    case P_bincvt::MAP:
+        if constexpr (std::is_convertible_v<binary_map, T>)
+            return P_map->clone();
+        else
+            break;
+    case P_bincvt::ARRAY:
+        if constexpr (std::is_convertible_v<binary_array, T>)
+            return P_array->clone();
+        else
+            break;
+    case P_bincvt::BUF:
+        if constexpr (std::is_convertible_v<byte_buf, T>)
+            return *P_buf;
+        else
+            break;
+    default:
+        print_throw(ARC_FATAL, "not convertible.");
+    }
+    return T{};
+}
+
+} // namespace arc
@@ -1,8 +1,10 @@
+#include <core/aio.h>
 #include <core/bin.h>
 #include <core/bio.h>
 #include <core/buffer.h>
 #include <core/io.h>
-
+#include <charconv>
+#include <string_view>
 
 namespace arc
 {
@@ -35,19 +37,19 @@ void P_write_primitive(byte_buf &buf, const binary_value &v)
         buf.write<double>(v.cast<double>());
         break;
     case P_bincvt::STRING_C:
-        buf.write_string(v.cast<std::string>());
+        buf.write_string_view(v.as_str());
         break;
     case P_bincvt::BOOL:
         buf.write<bool>(v.cast<bool>());
         break;
     case P_bincvt::MAP:
-        P_write_map(buf, v.cast<binary_map>());
+        P_write_map(buf, v.as_map());
         break;
     case P_bincvt::ARRAY:
-        P_write_array(buf, v.cast<binary_array>());
+        P_write_array(buf, v.as_array());
         break;
     case P_bincvt::BUF:
-        buf.write_byte_buf(v.cast<byte_buf>());
+        buf.write_byte_buf(v.as_buf());
         break;
     default:
         break;
@@ -58,11 +60,8 @@ void P_write_map(byte_buf &buf, const binary_map &map)
 {
     for (auto &kv : map.data)
     {
-        std::string str = kv.first;
-        binary_value v = kv.second;
-
-        P_write_primitive(buf, v);
-        buf.write_string(str);
+        P_write_primitive(buf, kv.second);
+        buf.write_string(kv.first);
     }
 
     buf.write<uint8_t>((uint8_t)P_bincvt::MAP_ENDV);
@@ -83,7 +82,7 @@ binary_value P_read_primitive(byte_buf &buf)
     uint8_t id = buf.read<uint8_t>();
 
     if (id == (uint8_t)P_bincvt::MAP_ENDV)
-        return {P_bincvt::MAP_ENDV, std::any(0)};
+        return binary_value();
 
     switch ((P_bincvt)id)
     {
@@ -100,7 +99,7 @@ binary_value P_read_primitive(byte_buf &buf)
     case P_bincvt::DOUBLE:
         return binary_value::make(buf.read<double>());
     case P_bincvt::STRING_C:
-        return binary_value::make(buf.read_string());
+        return binary_value::make_str(buf.read_string_view());
     case P_bincvt::BOOL:
         return binary_value::make(buf.read<bool>());
     case P_bincvt::MAP:
@@ -124,8 +123,7 @@ binary_map P_read_map(byte_buf &buf)
         if (bv.type == P_bincvt::MAP_ENDV)
             break;
 
-        std::string str = buf.read_string();
-        map.data[str] = bv;
+        map.data.insert_or_assign(buf.read_string(), std::move(bv));
     }
     return map;
 }
@@ -162,53 +160,64 @@ void bio_write(const binary_map &map, const path_handle &path)
     io_write_bytes(path, bio_write_buf(map).to_vector(), io_compression_level::OPTIMAL);
 }
 
-class P_binparser
+std::future<void> bio_write_async(const binary_map &map, const path_handle &path)
+{
+    return aio_write_bytes(path, bio_write_buf(map).to_vector(), io_compression_level::OPTIMAL);
+}
+
+// a single-pass scanner over the text, feeding a visitor.
+// tokens are handed out as views into the input, only strings with escapes go through a scratch buffer.
+class P_langd_scanner
 {
   private:
-    std::string input;
-    size_t pos;
+    const char *beg;
+    const char *cur;
+    const char *end;
+    langd_visitor &vis;
+    std::string scratch;
 
-    void P_skipspace()
+    size_t P_pos() const
     {
-        while (pos < input.size() && std::isspace(input[pos]))
-            pos++;
+        return static_cast<size_t>(cur - beg);
     }
 
-    char P_cur_ch()
+    void P_skipspace()
     {
-        return (pos < input.size()) ? input[pos] : '\0';
+        while (cur < end && std::isspace(static_cast<unsigned char>(*cur)))
+            cur++;
     }
 
-    char P_nxt()
+    char P_cur_ch() const
     {
-        pos++;
-        return P_cur_ch();
+        return cur < end ? *cur : '\0';
     }
 
-    binary_value P_parse_value();
-    binary_value P_parse_bool();
-    binary_value P_parse_num();
-    std::string P_parse_key();
-    binary_value P_parse_str();
-    binary_value P_parse_arr();
-    binary_value P_parse_map();
+    void P_scan_value();
+    void P_scan_bool();
+    void P_scan_num();
+    void P_scan_key();
+    void P_scan_str();
+    void P_scan_arr();
+    void P_scan_map();
 
   public:
-    P_binparser(const std::string &str) : input(str), pos(0)
+    P_langd_scanner(std::string_view text, langd_visitor &v)
+        : beg(text.data()), cur(text.data()), end(text.data() + text.size()), vis(v)
     {
-        P_skipspace();
-        while (P_cur_ch() != '{')
-            P_nxt();
     }
 
-    binary_value P_parse_term()
+    void P_scan_term()
     {
-        P_skipspace();
-        return P_parse_value();
+        // skip the leading part (like 'return').
+        while (cur < end && *cur != '{')
+            cur++;
+        if (cur == end)
+            print_throw(ARC_FATAL, "binary root is not an object");
+        P_scan_map();
     }
 };
 
-binary_value P_binparser::P_parse_value()
+void P_langd_scanner::P_scan_value()
 {
     P_skipspace();
     char c = P_cur_ch();
@@ -216,229 +225,299 @@ binary_value P_binparser::P_parse_value()
     if (c == 'n')
         print_throw(ARC_FATAL, "cannot use a null value");
     if (c == 't' || c == 'f')
-        return P_parse_bool();
+        return P_scan_bool();
     if (c == '"')
-        return P_parse_str();
+        return P_scan_str();
     if (c == '[')
-        return P_parse_arr();
+        return P_scan_arr();
     if (c == '{')
-        return P_parse_map();
+        return P_scan_map();
     if (c == '-' || (c >= '0' && c <= '9'))
-        return P_parse_num();
+        return P_scan_num();
 
-    print_throw(ARC_FATAL, "unexpected character at position {}", pos);
+    print_throw(ARC_FATAL, "unexpected character at position {}", P_pos());
 }
 
-binary_value P_binparser::P_parse_bool()
+void P_langd_scanner::P_scan_bool()
 {
-    if (input.substr(pos, 4) == "true")
+    std::string_view rest(cur, end - cur);
+    if (rest.starts_with("true"))
     {
-        pos += 4;
-        return binary_value::make(true);
+        cur += 4;
+        vis.on_bool(true);
+        return;
     }
-    if (input.substr(pos, 5) == "false")
+    if (rest.starts_with("false"))
     {
-        pos += 5;
-        return binary_value::make(false);
+        cur += 5;
+        vis.on_bool(false);
+        return;
     }
-    print_throw(ARC_FATAL, "expected boolean at position {}", pos);
+    print_throw(ARC_FATAL, "expected boolean at position {}", P_pos());
 }
 
-binary_value P_binparser::P_parse_num()
+void P_langd_scanner::P_scan_num()
 {
-    size_t start = pos;
-
-    if (P_cur_ch() == '-')
-        P_nxt();
+    double value;
+    auto [ptr, ec] = std::from_chars(cur, end, value);
+    if (ec != std::errc())
+        print_throw(ARC_FATAL, "bad number at position {}", P_pos());
+    cur = ptr;
+    vis.on_number(value);
+}
 
-    while (pos < input.size() && std::isdigit(input[pos]))
-        P_nxt();
+void P_langd_scanner::P_scan_key()
+{
+    const char *start = cur;
+    while (cur < end && *cur != '=')
+        cur++;
+    if (cur == end)
+        print_throw(ARC_FATAL, "expected '=' after object key at position {}", P_pos());
+
+    const char *kend = cur;
+    while (kend > start && std::isspace(static_cast<unsigned char>(kend[-1])))
+        kend--;
+    vis.on_key(std::string_view(start, kend - start));
+    // skip '='
+    cur++;
+}
 
-    if (P_cur_ch() == '.')
+static void P_append_u8(std::string &str, uint32_t cp)
+{
+    if (cp <= 0x7F)
+        str += static_cast<char>(cp);
+    else if (cp <= 0x7FF)
     {
-        P_nxt();
-        while (pos < input.size() && std::isdigit(input[pos]))
-            P_nxt();
+        str += static_cast<char>(0xC0 | (cp >> 6));
+        str += static_cast<char>(0x80 | (cp & 0x3F));
     }
-
-    if (P_cur_ch() == 'e' || P_cur_ch() == 'E')
+    else
     {
-        P_nxt();
-        if (P_cur_ch() == '+' || P_cur_ch() == '-')
-            P_nxt();
-        while (pos < input.size() && std::isdigit(input[pos]))
-            P_nxt();
+        str += static_cast<char>(0xE0 | (cp >> 12));
+        str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        str += static_cast<char>(0x80 | (cp & 0x3F));
     }
-
-    std::string numStr = input.substr(start, pos - start);
-    double value = std::stod(numStr);
-    return binary_value::make(value);
 }
 
-std::string P_binparser::P_parse_key()
+void P_langd_scanner::P_scan_str()
 {
-    std::string result;
-    while (pos < input.size() && P_cur_ch() != '=')
+    // skip '"'
+    cur++;
+    const char *start = cur;
+    while (cur < end && *cur != '"' && *cur != '\\')
+        cur++;
+
+    // the common case: no escapes, hand out the view directly.
+    if (cur < end && *cur == '"')
     {
-        char ch = P_cur_ch();
-        if (!std::isspace(ch))
-            result += ch;
-        P_nxt();
+        vis.on_string(std::string_view(start, cur - start));
+        cur++;
+        return;
     }
-    return result;
-}
-
-binary_value P_binparser::P_parse_str()
-{
-    if (P_cur_ch() != '"')
-        print_throw(ARC_FATAL, "expected '\"' at position {}", pos);
-    P_nxt();
 
-    std::string result;
-    while (pos < input.size() && P_cur_ch() != '"')
+    scratch.assign(start, cur - start);
+    while (cur < end && *cur != '"')
     {
-        char c = P_cur_ch();
+        char c = *cur++;
+        if (c != '\\')
+        {
+            scratch += c;
+            continue;
+        }
 
-        if (c == '\\')
+        if (cur == end)
+            break;
+        c = *cur++;
+        switch (c)
         {
-            P_nxt();
-            c = P_cur_ch();
-            switch (c)
-            {
-            case '"':
-                result += '"';
-                break;
-            case '\\':
-                result += '\\';
-                break;
-            case '/':
-                result += '/';
-                break;
-            case 'b':
-                result += '\b';
-                break;
-            case 'f':
-                result += '\f';
-                break;
-            case 'n':
-                result += '\n';
-                break;
-            case 'r':
-                result += '\r';
-                break;
-            case 't':
-                result += '\t';
-                break;
-            case 'u':
-                P_nxt();
-                for (int i = 0; i < 4 && pos < input.size(); i++)
-                {
-                    P_nxt();
-                }
-                result += '?';
-                break;
-            default:
-                result += c;
-                break;
-            }
+        case 'b':
+            scratch += '\b';
+            break;
+        case 'f':
+            scratch += '\f';
+            break;
+        case 'n':
+            scratch += '\n';
+            break;
+        case 'r':
+            scratch += '\r';
+            break;
+        case 't':
+            scratch += '\t';
+            break;
+        case 'u': {
+            uint32_t cp = 0;
+            auto [ptr, ec] = std::from_chars(cur, std::min(cur + 4, end), cp, 16);
+            if (ec != std::errc() || ptr != cur + 4)
+                print_throw(ARC_FATAL, "bad unicode escape at position {}", P_pos());
+            cur = ptr;
+            P_append_u8(scratch, cp);
+            break;
+        }
+        default:
+            // '"', '\\', '/' and unknown escapes stand for themselves.
+            scratch += c;
+            break;
         }
-        else
-            result += c;
-        P_nxt();
     }
 
-    if (P_cur_ch() != '"')
-        print_throw(ARC_FATAL, "unterminated std::stringat position {}", pos);
-    P_nxt();
-
-    return binary_value::make(result);
+    if (cur == end)
+        print_throw(ARC_FATAL, "unterminated string at position {}", P_pos());
+    cur++;
+    vis.on_string(scratch);
 }
 
-binary_value P_binparser::P_parse_arr()
+void P_langd_scanner::P_scan_arr()
 {
-    if (P_cur_ch() != '[')
-        print_throw(ARC_FATAL, "expected '[' at position {}", pos);
-    P_nxt();
-
-    binary_array result;
+    // skip '['
+    cur++;
+    vis.on_array_begin();
     P_skipspace();
 
     if (P_cur_ch() == ']')
     {
-        P_nxt();
-        return binary_value::make(result);
+        cur++;
+        vis.on_array_end();
+        return;
     }
 
-    while (pos < input.size())
+    while (true)
     {
-        result.data.push_back(P_parse_value());
-
+        P_scan_value();
         P_skipspace();
-        if (P_cur_ch() == ']')
+        char c = P_cur_ch();
+        cur++;
+        if (c == ']')
             break;
-        if (P_cur_ch() != ',')
-            print_throw(ARC_FATAL, "expected ',' or ']' in array at position {}", pos);
-        P_nxt();
-        P_skipspace();
+        if (c != ',')
+            print_throw(ARC_FATAL, "expected ',' or ']' in array at position {}", P_pos() - 1);
     }
 
-    if (P_cur_ch() != ']')
-        print_throw(ARC_FATAL, "unterminated array at position {}", pos);
-    P_nxt();
-
-    return binary_value::make(result);
+    vis.on_array_end();
 }
 
-binary_value P_binparser::P_parse_map()
+void P_langd_scanner::P_scan_map()
 {
-    if (P_cur_ch() != '{')
-        print_throw(ARC_FATAL, "expected '{' at position {}", pos);
-    P_nxt();
-
-    binary_map result;
+    // skip '{'
+    cur++;
+    vis.on_map_begin();
     P_skipspace();
 
     if (P_cur_ch() == '}')
     {
-        P_nxt();
-        return binary_value::make(result);
+        cur++;
+        vis.on_map_end();
+        return;
     }
 
-    while (pos < input.size())
+    while (true)
     {
         P_skipspace();
-        std::string key = P_parse_key();
+        P_scan_key();
+        P_scan_value();
         P_skipspace();
-        if (P_cur_ch() != '=')
-            print_throw(ARC_FATAL, "expected '=' after object key at position {}", pos);
-        P_nxt();
+        char c = P_cur_ch();
+        cur++;
+        if (c == '}')
+            break;
+        if (c != ',')
+            print_throw(ARC_FATAL, "expected ',' or '}}' in object at position {}", P_pos() - 1);
+    }
 
-        binary_value value = P_parse_value();
-        result.data[key] = value;
+    vis.on_map_end();
+}
 
-        P_skipspace();
+// builds the binary map in place: nested containers are linked into their parent
+// before being filled, so nothing is copied on the way up.
+struct P_langd_builder : langd_visitor
+{
+    struct P_frame
+    {
+        binary_map *map;
+        binary_array *arr;
+    };
 
-        if (P_cur_ch() == '}')
-            break;
-        if (P_cur_ch() != ',')
-            print_throw(ARC_FATAL, "expected ',' or '}' in object at position {}", pos);
+    binary_map root;
+    std::vector<P_frame> stack;
+    std::string key;
+
+    void P_put(binary_value &&v)
+    {
+        P_frame &f = stack.back();
+        if (f.map != nullptr)
+            f.map->data.insert_or_assign(key, std::move(v));
+        else
+            f.arr->data.push_back(std::move(v));
+    }
+
+    void on_map_begin() override
+    {
+        if (stack.empty())
+        {
+            stack.push_back({&root, nullptr});
+            return;
+        }
+        binary_value v = binary_value::make(binary_map());
+        binary_map *raw = &v.as_map();
+        P_put(std::move(v));
+        stack.push_back({raw, nullptr});
+    }
+
+    void on_map_end() override
+    {
+        stack.pop_back();
+    }
 
-        P_nxt();
+    void on_array_begin() override
+    {
+        binary_value v = binary_value::make(binary_array());
+        binary_array *raw = &v.as_array();
+        P_put(std::move(v));
+        stack.push_back({nullptr, raw});
+    }
+
+    void on_array_end() override
+    {
+        stack.pop_back();
+    }
+
+    void on_key(std::string_view k) override
+    {
+        key.assign(k);
+    }
+
+    void on_number(double v) override
+    {
+        P_put(binary_value::make(v));
     }
 
-    if (P_cur_ch() != '}')
-        print_throw(ARC_FATAL, "unterminated object at position {}", pos);
-    P_nxt();
+    void on_bool(bool v) override
+    {
+        P_put(binary_value::make(v));
+    }
+
+    void on_string(std::string_view v) override
+    {
+        P_put(binary_value::make_str(v));
+    }
+};
 
-    return binary_value::make(result);
+void bio_scan_langd(std::string_view text, langd_visitor &visitor)
+{
+    P_langd_scanner(text, visitor).P_scan_term();
+}
+
+binary_map bio_read_langd_str(std::string_view text)
+{
+    P_langd_builder builder;
+    bio_scan_langd(text, builder);
+    return std::move(builder.root);
 }
 
 binary_map bio_read_langd(const path_handle &path)
 {
-    binary_value result = P_binparser(io_read_str(path)).P_parse_term();
-    if (result.type != P_bincvt::MAP)
-        print_throw(ARC_FATAL, "binary root is not an object");
-    return result.cast<binary_map>();
+    std::shared_ptr<mapped_file> mf = io_map_file(path);
+    return bio_read_langd_str(mf->view());
 }
 
 } // namespace arc
@@ -2,6 +2,8 @@
 #include <core/io.h>
 #include <core/bin.h>
 #include <core/buffer.h>
+#include <future>
+#include <string_view>
 
 namespace arc
 {
@@ -10,7 +12,46 @@ binary_map bio_read_buf(byte_buf &v);
 byte_buf bio_write_buf(const binary_map &map);
 binary_map bio_read(const path_handle &path);
 void bio_write(const binary_map &map, const path_handle &path);
+// serialize the map now, and compress & write it on the i/o workers (see #core/aio.h).
+std::future<void> bio_write_async(const binary_map &map, const path_handle &path);
 // read a script-form binary map (like json, but not the same).
 binary_map bio_read_langd(const path_handle &path);
+binary_map bio_read_langd_str(std::string_view text);
+
+// a sax-style visitor of a script-form binary map.
+// views passed in are only valid during the call.
+struct langd_visitor
+{
+    virtual ~langd_visitor() = default;
+
+    virtual void on_map_begin()
+    {
+    }
+    virtual void on_map_end()
+    {
+    }
+    virtual void on_array_begin()
+    {
+    }
+    virtual void on_array_end()
+    {
+    }
+    // the key of the next value in the current map.
+    virtual void on_key(std::string_view)
+    {
+    }
+    virtual void on_number(double)
+    {
+    }
+    virtual void on_bool(bool)
+    {
+    }
+    virtual void on_string(std::string_view)
+    {
+    }
+};
+
+// scan a script-form binary map without building it.
+void bio_scan_langd(std::string_view text, langd_visitor &visitor);
 
 } // namespace arc
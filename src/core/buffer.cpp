@@ -102,6 +102,11 @@ void byte_buf::write_byte_buf(const byte_buf &buf)
 }
 
 void byte_buf::write_string(const std::string &str)
+{
+    write_string_view(str);
+}
+
+void byte_buf::write_string_view(std::string_view str)
 {
     write<unsigned int>(str.size());
     write_bytes(str.data(), str.size());
@@ -129,11 +134,16 @@ byte_buf byte_buf::read_byte_buf()
 }
 
 std::string byte_buf::read_string()
+{
+    return std::string(read_string_view());
+}
+
+std::string_view byte_buf::read_string_view()
 {
     ensure_readable(sizeof(unsigned int));
     size_t len = read<unsigned int>();
     ensure_readable(len);
-    std::string str(reinterpret_cast<const char *>(P_data.data() + P_rpos), len);
+    std::string_view str(reinterpret_cast<const char *>(P_data.data() + P_rpos), len);
     P_rpos += len;
     return str;
 }
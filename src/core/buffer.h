@@ -3,6 +3,7 @@
 #include <core/log.h>
 #include <vector>
 #include <cstring>
+#include <string_view>
 #include <core/uuid.h>
 
 namespace arc
@@ -73,6 +74,7 @@ struct byte_buf
     void write_bytes(const void *src, size_t len);
     void write_byte_buf(const byte_buf &buf);
     void write_string(const std::string &str);
+    void write_string_view(std::string_view str);
     void write_uuid(const uuid &id);
 
     template <typename T> typename std::enable_if<std::is_arithmetic<T>::value, T>::type read()
@@ -87,6 +89,8 @@ struct byte_buf
     void read_bytes(void *dst, size_t len);
     byte_buf read_byte_buf();
     std::string read_string();
+    // a view into the buffer, valid until the buffer is modified.
+    std::string_view read_string_view();
     uuid read_uuid();
 
     template <typename T> T peek() const
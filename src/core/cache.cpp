@@ -0,0 +1,133 @@
+#include <atomic>
+#include <core/buffer.h>
+#include <core/cache.h>
+#include <core/log.h>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+
+namespace arc
+{
+
+constexpr static uint32_t P_CACHE_MAGIC = 0x43435241; // "ARCC"
+constexpr static size_t P_CACHE_HEADER_BYTES = 24;
+
+path_handle asset_cache::P_entry_path(std::string_view name, std::string_view kind) const
+{
+    return dir / fmt::format("{:016x}.{}", io_hash64(name.data(), name.size()), kind);
+}
+
+std::optional<asset_cache_blob> asset_cache::get(std::string_view name, std::string_view kind, uint64_t src_hash,
+                                                 uint32_t version)
+{
+    path_handle path = P_entry_path(name, kind);
+    if (io_judge(path) != path_type::FILE)
+        return std::nullopt;
+
+    std::shared_ptr<mapped_file> file;
+    try
+    {
+        file = io_map_file(path);
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+    if (file->size < P_CACHE_HEADER_BYTES)
+        return std::nullopt;
+
+    byte_buf head = byte_buf(std::vector<uint8_t>(file->data, file->data + P_CACHE_HEADER_BYTES));
+    uint32_t magic = head.read<uint32_t>();
+    uint32_t ver = head.read<uint32_t>();
+    uint64_t hash = head.read<uint64_t>();
+    uint64_t size = head.read<uint64_t>();
+
+    // a changed source or a newer loader, the entry will be overwritten.
+    if (magic != P_CACHE_MAGIC || ver != version || hash != src_hash)
+        return std::nullopt;
+    if (size != file->size - P_CACHE_HEADER_BYTES)
+        return std::nullopt;
+
+    asset_cache_blob blob;
+    blob.data = file->data + P_CACHE_HEADER_BYTES;
+    blob.size = size;
+    blob.P_file = std::move(file);
+    return blob;
+}
+
+void asset_cache::put(std::string_view name, std::string_view kind, uint64_t src_hash, uint32_t version,
+                      const std::vector<uint8_t> &blob)
+{
+    static std::atomic<uint64_t> seq = 0;
+
+    path_handle path = P_entry_path(name, kind);
+    path_handle tmp = io_open(fmt::format("{}.{}.tmp", path.abs_path, seq++));
+
+    byte_buf head;
+    head.write<uint32_t>(P_CACHE_MAGIC);
+    head.write<uint32_t>(version);
+    head.write<uint64_t>(src_hash);
+    head.write<uint64_t>(blob.size());
+
+    // the cache is only an optimization, failing to write it is not fatal.
+    try
+    {
+        fs::create_directories(dir.P_npath);
+        bool ok;
+        {
+            std::ofstream file(tmp.P_npath, std::ios::binary);
+            file.write(reinterpret_cast<const char *>(head.P_data.data()), head.size());
+            file.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+            ok = static_cast<bool>(file);
+        }
+        if (ok)
+            io_rename(tmp, path.abs_path);
+        else
+            print(ARC_WARN, "cannot write asset cache: {}", tmp.abs_path);
+    }
+    catch (const std::exception &e)
+    {
+        print(ARC_WARN, "cannot write asset cache: {}", e.what());
+    }
+    if (io_exists(tmp))
+        io_del(tmp);
+}
+
+void asset_cache::clear()
+{
+    if (io_judge(dir) != path_type::DIR)
+        return;
+    for (const path_handle &path : io_sub_files(dir))
+        io_del(path);
+}
+
+std::shared_ptr<asset_cache> asset_cache::make(const path_handle &dir)
+{
+    std::shared_ptr<asset_cache> cache = std::make_shared<asset_cache>();
+    cache->dir = dir;
+    return cache;
+}
+
+static std::mutex P_cache_mutex;
+static bool P_cache_set = false;
+static std::shared_ptr<asset_cache> P_cache;
+
+std::shared_ptr<asset_cache> asset_cache_get()
+{
+    std::lock_guard<std::mutex> lock(P_cache_mutex);
+    if (!P_cache_set)
+    {
+        P_cache = asset_cache::make(io_open_local("cache"));
+        P_cache_set = true;
+    }
+    return P_cache;
+}
+
+void asset_cache_set(std::shared_ptr<asset_cache> cache)
+{
+    std::lock_guard<std::mutex> lock(P_cache_mutex);
+    P_cache = std::move(cache);
+    P_cache_set = true;
+}
+
+} // namespace arc
@@ -0,0 +1,51 @@
+#pragma once
+#include <core/def.h>
+#include <core/io.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace arc
+{
+
+// a cached blob. the bytes are mapped from the cache file, and are valid as long as the blob is alive.
+struct asset_cache_blob
+{
+    std::shared_ptr<mapped_file> P_file;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+// a persistent on-disk cache of preprocessed asset data, like decoded pixels and rasterized glyphs.
+//
+// there is one entry per (name, kind), and it records the content hash of its source and the version
+// of the code that made it. if either differs at lookup, the entry is stale and treated as absent,
+// and the next #put overwrites it. so invalidation is automatic, and the cache never grows with
+// the old versions of an asset.
+//
+// writes are atomic (temporary file, then rename), so a crashed write is never read back.
+// #get and #put can be called from any thread.
+struct asset_cache
+{
+    path_handle dir;
+
+    std::optional<asset_cache_blob> get(std::string_view name, std::string_view kind, uint64_t src_hash,
+                                        uint32_t version);
+    void put(std::string_view name, std::string_view kind, uint64_t src_hash, uint32_t version,
+             const std::vector<uint8_t> &blob);
+    // remove all entries.
+    void clear();
+
+    path_handle P_entry_path(std::string_view name, std::string_view kind) const;
+
+    static std::shared_ptr<asset_cache> make(const path_handle &dir);
+};
+
+// the cache used by the built-in loaders, by default it is "cache/" under the execution path.
+// set it to nullptr to disable caching.
+std::shared_ptr<asset_cache> asset_cache_get();
+void asset_cache_set(std::shared_ptr<asset_cache> cache);
+
+} // namespace arc
@@ -1,64 +1,217 @@
+#include <atomic>
 #include <core/id.h>
+#include <core/log.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace arc
 {
 
+struct P_uid_entry
+{
+    std::string concat;
+    uint64_t hash = 0;
+    // the length of the scope, the key starts after the colon.
+    size_t colon = 0;
+};
+
+constexpr static uint32_t P_UID_CHUNK_BITS = 12;
+constexpr static uint32_t P_UID_CHUNK_SIZE = 1u << P_UID_CHUNK_BITS;
+constexpr static uint32_t P_UID_MAX_CHUNKS = 4096;
+
+// an open-addressed table from the hash of an id to its index. a slot holds the index + 1, 0 is empty.
+// a slot is written once and never cleared, so it can be probed without a lock.
+struct P_uid_table
+{
+    uint32_t mask;
+    std::unique_ptr<std::atomic<uint32_t>[]> slots;
+
+    explicit P_uid_table(uint32_t capacity) : mask(capacity - 1), slots(new std::atomic<uint32_t>[capacity])
+    {
+        for (uint32_t i = 0; i < capacity; i++)
+            slots[i].store(0, std::memory_order_relaxed);
+    }
+};
+
+static void P_uid_place(P_uid_table &tab, uint64_t hash, uint32_t index)
+{
+    uint32_t i = static_cast<uint32_t>(hash) & tab.mask;
+    while (tab.slots[i].load(std::memory_order_relaxed) != 0)
+        i = (i + 1) & tab.mask;
+    tab.slots[i].store(index + 1, std::memory_order_release);
+}
+
+// entries are stored in chunks that never move, and an entry is immutable once published,
+// so reading one by index needs no lock, and neither does finding an interned string.
+// only interning a new string locks, writers are serialized by #mutex.
+struct P_uid_pool
+{
+    std::atomic<P_uid_entry *> chunks[P_UID_MAX_CHUNKS] = {};
+    std::atomic<uint32_t> size = 0;
+    std::mutex mutex;
+    std::atomic<P_uid_table *> table = nullptr;
+    // replaced tables are kept, since a reader may still be probing one.
+    std::vector<std::unique_ptr<P_uid_table>> tables;
+
+    P_uid_pool()
+    {
+        tables.push_back(std::make_unique<P_uid_table>(1024));
+        table = tables.back().get();
+
+        // index 0 is the empty id.
+        P_uid_entry *chunk = new P_uid_entry[P_UID_CHUNK_SIZE];
+        chunk[0].hash = unique_id_hash("");
+        chunk[0].colon = std::string::npos;
+        chunks[0] = chunk;
+        P_uid_place(*tables.back(), chunk[0].hash, 0);
+        size = 1;
+    }
+};
+
+static P_uid_pool &P_get_uid_pool()
+{
+    // never destroyed, ids may be used during static destruction.
+    static P_uid_pool *pool = new P_uid_pool();
+    return *pool;
+}
+
+static const P_uid_entry &P_uid_get(uint32_t index)
+{
+    P_uid_pool &pool = P_get_uid_pool();
+    P_uid_entry *chunk = pool.chunks[index >> P_UID_CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk[index & (P_UID_CHUNK_SIZE - 1)];
+}
+
+// the strings are only compared when the hashes match. -1 when it is not in #tab.
+static int64_t P_uid_find(const P_uid_table &tab, std::string_view cat, uint64_t hash)
+{
+    for (uint32_t i = static_cast<uint32_t>(hash) & tab.mask;; i = (i + 1) & tab.mask)
+    {
+        uint32_t slot = tab.slots[i].load(std::memory_order_acquire);
+        if (slot == 0)
+            return -1;
+        const P_uid_entry &e = P_uid_get(slot - 1);
+        if (e.hash == hash && e.concat == cat)
+            return slot - 1;
+    }
+}
+
+static uint32_t P_uid_insert(P_uid_pool &pool, std::string_view cat, uint64_t hash)
+{
+    uint32_t index = pool.size.load(std::memory_order_relaxed);
+    uint32_t ci = index >> P_UID_CHUNK_BITS;
+    if (ci >= P_UID_MAX_CHUNKS)
+        print_throw(ARC_FATAL, "too many unique ids.");
+    if (pool.chunks[ci].load(std::memory_order_relaxed) == nullptr)
+        pool.chunks[ci].store(new P_uid_entry[P_UID_CHUNK_SIZE], std::memory_order_release);
+
+    P_uid_entry &e = pool.chunks[ci].load(std::memory_order_relaxed)[index & (P_UID_CHUNK_SIZE - 1)];
+    e.concat = std::string(cat);
+    e.hash = hash;
+    e.colon = e.concat.find_last_of(':');
+    pool.size.store(index + 1, std::memory_order_release);
+
+    // kept at most half full. a grown table is filled before it is published, so a reader sees every id in it.
+    P_uid_table *tab = pool.table.load(std::memory_order_relaxed);
+    if ((index + 1) * 2 > tab->mask + 1)
+    {
+        auto grown = std::make_unique<P_uid_table>((tab->mask + 1) * 2);
+        for (uint32_t i = 0; i < index; i++)
+            P_uid_place(*grown, P_uid_get(i).hash, i);
+        tab = grown.get();
+        pool.tables.push_back(std::move(grown));
+    }
+    P_uid_place(*tab, hash, index);
+    pool.table.store(tab, std::memory_order_release);
+    return index;
+}
+
+uint32_t P_uid_intern(std::string_view cat, uint64_t hash)
+{
+    P_uid_pool &pool = P_get_uid_pool();
+    int64_t found = P_uid_find(*pool.table.load(std::memory_order_acquire), cat, hash);
+    if (found >= 0)
+        return static_cast<uint32_t>(found);
+
+    // a reader of a replaced table may miss a new id, so the lookup is repeated under the lock.
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    found = P_uid_find(*pool.table.load(std::memory_order_relaxed), cat, hash);
+    if (found >= 0)
+        return static_cast<uint32_t>(found);
+    return P_uid_insert(pool, cat, hash);
+}
+
 unique_id::unique_id() = default;
 
 unique_id::unique_id(const std::string &cat)
 {
     auto pos = cat.find_last_of(':');
 
+    std::string full;
     if (pos == std::string::npos)
-    {
-        key = cat;
-        scope = LIB_NAME;
-        concat = LIB_NAME + cat;
-    }
+        full = std::string(LIB_NAME) + ":" + cat;
+    else if (pos == 0)
+        full = std::string(LIB_NAME) + cat;
     else
-    {
-        key = cat.substr(pos + 1);
-        scope = cat.substr(0, pos);
-        concat = cat;
-    }
+        full = cat;
 
-    P_hash = std::hash<std::string>{}(concat);
+    P_hash = unique_id_hash(full);
+    P_index = P_uid_intern(full, P_hash);
 }
 
-unique_id::unique_id(const std::string &sc, const std::string &k)
+unique_id::unique_id(const std::string &sc, const std::string &k) : unique_id(sc + ":" + k)
 {
-    scope = sc;
-    key = k;
-    concat = sc + ":" + key;
-    P_hash = std::hash<std::string>{}(concat);
 }
 
 unique_id::unique_id(const char ch_arr[]) : unique_id(std::string(ch_arr))
 {
 }
 
-path_handle unique_id::find_path()
+unique_id::unique_id(unique_id_literal lit)
 {
-    if (scope == LIB_NAME)
-        return io_open_local("") / key;
-    return {}; // todo: add mod system
+    auto pos = lit.text.find_last_of(':');
+    if (pos == std::string_view::npos || pos == 0)
+    {
+        // not a full id, so the precomputed hash is not of the interned string.
+        *this = unique_id(std::string(lit.text));
+        return;
+    }
+    P_hash = lit.hash;
+    P_index = P_uid_intern(lit.text, lit.hash);
 }
 
-unique_id::operator std::string() const
+const std::string &unique_id::concat() const
+{
+    return P_uid_get(P_index).concat;
+}
+
+std::string_view unique_id::scope() const
 {
-    return concat;
+    const P_uid_entry &e = P_uid_get(P_index);
+    if (e.colon == std::string::npos)
+        return {};
+    return std::string_view(e.concat).substr(0, e.colon);
 }
 
-bool unique_id::operator==(const unique_id &other) const
+std::string_view unique_id::key() const
 {
-    if (other.P_hash != P_hash)
-        return false;
-    return other.concat == concat;
+    const P_uid_entry &e = P_uid_get(P_index);
+    if (e.colon == std::string::npos)
+        return e.concat;
+    return std::string_view(e.concat).substr(e.colon + 1);
 }
 
-bool unique_id::operator<(const unique_id &other) const
+path_handle unique_id::find_path()
+{
+    if (scope() == LIB_NAME)
+        return io_open_local("") / std::string(key());
+    return {}; // todo: add mod system
+}
+
+unique_id::operator std::string() const
 {
-    return other.concat < concat;
+    return concat();
 }
 
 } // namespace arc
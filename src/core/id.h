@@ -1,31 +1,76 @@
 #pragma once
 #include <core/def.h>
 #include <core/io.h>
+#include <cstdint>
 #include <string>
-#include <core/io.h>
+#include <string_view>
 
 namespace arc
 {
 
+// the 64-bit fnv-1a hash of an id string, it can be evaluated at compile time.
+constexpr uint64_t unique_id_hash(std::string_view str)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (char c : str)
+    {
+        h ^= static_cast<uint8_t>(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// an id string known at compile time, with its hash precomputed. see the literal operator "_uid".
+struct unique_id_literal
+{
+    std::string_view text;
+    uint64_t hash;
+};
+
+// an interned "scope:key" string.
+// it is a 32-bit index into the global string pool plus the precomputed 64-bit hash, so copying it is trivial,
+// and comparing it is an integer compare. the strings are only touched when asked for.
 struct unique_id
 {
-    std::string scope;
-    std::string key;
-    std::string concat;
-    size_t P_hash;
+    uint32_t P_index = 0;
+    uint64_t P_hash = 0;
 
     unique_id();
     // supports: I. scope:key, II. :key -> def_scope:key, III. key -> def_scope:key
     unique_id(const std::string &cat);
     unique_id(const std::string &sc, const std::string &k);
     unique_id(const char ch_arr[]);
+    unique_id(unique_id_literal lit);
+
+    const std::string &concat() const;
+    std::string_view scope() const;
+    std::string_view key() const;
 
     path_handle find_path();
     operator std::string() const;
-    bool operator==(const unique_id &other) const;
-    bool operator<(const unique_id &other) const;
+
+    bool operator==(const unique_id &other) const
+    {
+        return P_index == other.P_index;
+    }
+
+    // orders by interning, which is stable during a run but not across runs.
+    bool operator<(const unique_id &other) const
+    {
+        return P_index < other.P_index;
+    }
 };
 
+// intern a full "scope:key" string, #hash should be #unique_id_hash of it.
+uint32_t P_uid_intern(std::string_view cat, uint64_t hash);
+
+// a compile-time id: "arcaie:gfx/misc/test.png"_uid.
+// its hash is a constant (usable in a switch on #unique_id::P_hash), and it converts into a #unique_id.
+consteval unique_id_literal operator""_uid(const char *str, size_t len)
+{
+    return {std::string_view(str, len), unique_id_hash(std::string_view(str, len))};
+}
+
 } // namespace arc
 
 namespace std
@@ -35,7 +80,7 @@ template <> struct hash<arc::unique_id>
 {
     std::size_t operator()(const arc::unique_id &id) const noexcept
     {
-        return id.P_hash;
+        return static_cast<std::size_t>(id.P_hash);
     }
 };
 
@@ -2,6 +2,17 @@
 #include <core/log.h>
 #include <fstream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define BROTLI_IMPLEMENTATION
 #include <brotli/decode.h>
 #include <brotli/encode.h>
@@ -68,6 +79,28 @@ void io_rename(const path_handle &path, const std::string &name)
     fs::rename(path.P_npath, name);
 }
 
+bool io_sync(const path_handle &path)
+{
+#ifdef _WIN32
+    if (io_judge(path) == path_type::DIR)
+        return true;
+    HANDLE file = CreateFileW(path.P_npath.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = open(path.abs_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
 bool io_exists(const path_handle &path)
 {
     return fs::exists(path.P_npath);
@@ -214,6 +247,77 @@ void io_write_str(const path_handle &path, const std::string &text)
                                               reinterpret_cast<const uint8_t *>(text.data() + text.size())));
 }
 
+mapped_file::~mapped_file()
+{
+#ifdef _WIN32
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (P_mapping != nullptr)
+        CloseHandle(P_mapping);
+    if (P_file != nullptr)
+        CloseHandle(P_file);
+#else
+    if (data != nullptr)
+        munmap(const_cast<uint8_t *>(data), size);
+#endif
+}
+
+std::string_view mapped_file::view() const
+{
+    return std::string_view(reinterpret_cast<const char *>(data), size);
+}
+
+std::shared_ptr<mapped_file> io_map_file(const path_handle &path)
+{
+    std::shared_ptr<mapped_file> mf = std::make_shared<mapped_file>();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.P_npath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        print_throw(ARC_FATAL, "cannot find {}", path.abs_path);
+    mf->P_file = file;
+
+    LARGE_INTEGER len;
+    GetFileSizeEx(file, &len);
+    mf->size = static_cast<size_t>(len.QuadPart);
+    // an empty file cannot be mapped.
+    if (mf->size == 0)
+        return mf;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+        print_throw(ARC_FATAL, "cannot map {}", path.abs_path);
+    mf->P_mapping = mapping;
+    mf->data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = open(path.abs_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        print_throw(ARC_FATAL, "cannot find {}", path.abs_path);
+
+    struct stat st;
+    fstat(fd, &st);
+    mf->size = static_cast<size_t>(st.st_size);
+    // an empty file cannot be mapped.
+    if (mf->size == 0)
+    {
+        close(fd);
+        return mf;
+    }
+
+    void *ptr = mmap(nullptr, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file.
+    close(fd);
+    if (ptr == MAP_FAILED)
+        ptr = nullptr;
+    mf->data = static_cast<const uint8_t *>(ptr);
+#endif
+
+    if (mf->data == nullptr)
+        print_throw(ARC_FATAL, "cannot map {}", path.abs_path);
+    return mf;
+}
+
 std::vector<uint8_t> io_compress(std::vector<uint8_t> buf, io_compression_level clvl)
 {
     std::vector<uint8_t> out;
@@ -242,4 +346,16 @@ std::vector<uint8_t> io_decompress(std::vector<uint8_t> buf)
     return brotli_decompress(buf);
 }
 
+uint64_t io_hash64(const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
 } // namespace arc
\ No newline at end of file
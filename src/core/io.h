@@ -1,6 +1,8 @@
 #pragma once
 #include <core/def.h>
 #include <filesystem>
+#include <memory>
+#include <string_view>
 #include <vector>
 #include <core/buffer.h>
 
@@ -44,6 +46,9 @@ path_handle io_open_local(const std::string &name);
 path_handle io_parent(const path_handle &path);
 void io_del(const path_handle &path);
 void io_rename(const path_handle &path, const std::string &name);
+// block until the contents of a file, or the entries of a directory, are on the disk. false if they cannot be.
+// directories are not synced on windows, where renames are journaled.
+bool io_sync(const path_handle &path);
 bool io_exists(const path_handle &path);
 // if the path is a file, create its parent directories and an empty file.
 // if the path is a directory, create it and its parent directories.
@@ -74,7 +79,28 @@ void io_write_bytes(const path_handle &path, const std::vector<uint8_t> &data,
                     io_compression_level clvl = io_compression_level::NO);
 std::string io_read_str(const path_handle &path);
 void io_write_str(const path_handle &path, const std::string &text);
+// a read-only memory mapping of a whole file.
+// the bytes are valid as long as the mapping is alive.
+struct mapped_file
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    /* unstable */ void *P_file = nullptr;
+    /* unstable */ void *P_mapping = nullptr;
+
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file();
+
+    std::string_view view() const;
+};
+
+// map a file into memory instead of reading it into a buffer.
+std::shared_ptr<mapped_file> io_map_file(const path_handle &path);
 std::vector<uint8_t> io_compress(std::vector<uint8_t> buf, io_compression_level clvl = io_compression_level::OPTIMAL);
+// the 64-bit fnv-1a hash of the bytes, stable across runs and platforms.
+uint64_t io_hash64(const void *data, size_t len);
 std::vector<uint8_t> io_decompress(std::vector<uint8_t> buf);
 
 } // namespace arc
\ No newline at end of file
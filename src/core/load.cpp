@@ -1,22 +1,48 @@
-#include <audio/device.h>
 #include <core/load.h>
-#include <gfx/device.h>
-#include <gfx/font.h>
-#include <gfx/image.h>
 #include <core/io.h>
 #include <core/id.h>
-
-using namespace arc::gfx;
-using namespace arc::audio;
+#include <core/log.h>
+#include <core/pool.h>
+#include <core/prof.h>
+#include <chrono>
 
 namespace arc
 {
 
-std::unordered_map<unique_id, std::any> P_resource_map;
+static thread_pool &P_get_asset_pool()
+{
+    static std::shared_ptr<thread_pool> pool = thread_pool::make();
+    return *pool;
+}
+
+std::vector<uint8_t> asset_source::read_bytes() const
+{
+    if (pack != nullptr)
+        return pack->read(*entry);
+    return io_read_bytes(path);
+}
 
-std::unordered_map<unique_id, std::any> &P_get_resource_map()
+std::string asset_source::read_str() const
 {
-    return P_resource_map;
+    std::vector<uint8_t> bytes = read_bytes();
+    return std::string(bytes.begin(), bytes.end());
+}
+
+void asset_loader::P_push(const asset_source &src, const unique_id &id, const std::string &fmt)
+{
+    // a custom strategy overrides the built-in one for the same format.
+    if (process_strategy_map.find(fmt) != process_strategy_map.end())
+    {
+        proc_strategy sttg = process_strategy_map[fmt];
+        P_pending.push({priority, P_seq++, id, nullptr, [sttg, path = src.path, id]() { sttg(path, id); }});
+        P_total_tcount++;
+    }
+    else if (async_strategy_map.find(fmt) != async_strategy_map.end())
+    {
+        async_strategy sttg = async_strategy_map[fmt];
+        P_pending.push({priority, P_seq++, id, [sttg, src, id]() { return sttg(src, id); }, nullptr});
+        P_total_tcount++;
+    }
 }
 
 void asset_loader::scan(const path_handle &path_root)
@@ -24,79 +50,175 @@ void asset_loader::scan(const path_handle &path_root)
     for (const path_handle &path : io_recurse_files(path_root))
     {
         if (io_judge(path) == path_type::FILE)
+            P_push({path, nullptr, nullptr}, unique_id(scope, path - root), path.file_format());
+    }
+}
+
+void asset_loader::scan_pack(std::shared_ptr<asset_pack> pack)
+{
+    // no directory traversal and no per-file open, the index has everything.
+    for (const asset_pack_entry &e : pack->entries)
+    {
+        path_handle path = root / e.key;
+        P_push({path, pack, &e}, unique_id(scope, e.key), path.file_format());
+    }
+}
+
+void asset_loader::add_sub(std::shared_ptr<asset_loader> subloader)
+{
+    subloaders.push_back(subloader);
+}
+
+void asset_loader::P_dispatch()
+{
+    thread_pool &pool = P_get_asset_pool();
+    // only keep a few tasks ahead of the uploads, so that a task with higher priority scanned later
+    // does not wait behind the whole queue, and decoded data does not pile up in memory.
+    size_t cap = pool.size() * 2;
+
+    while (!P_pending.empty())
+    {
+        std::lock_guard<std::mutex> lock(P_uploads->mutex);
+        if (P_uploads->inflight + P_uploads->tasks.size() >= cap)
+            break;
+
+        P_asset_task task = P_pending.top();
+        P_pending.pop();
+
+        if (!task.decode)
         {
-            unique_id id = unique_id(scope, path - root);
-            std::string fmt = path.file_format();
+            P_uploads->tasks.push(std::move(task));
+            continue;
+        }
 
-            if (process_strategy_map.find(fmt) != process_strategy_map.end())
+        P_uploads->inflight++;
+        pool.submit([q = P_uploads, task = std::move(task)]() mutable {
+            try
             {
-                proc_strategy sttg = process_strategy_map[fmt];
-                tasks.push([sttg, path, id]() { sttg(path, id); });
-                P_total_tcount++;
+                task.upload = task.decode();
             }
-        }
+            catch (...)
+            {
+                // rethrow where the loader is driven, instead of losing it in the worker.
+                std::exception_ptr e = std::current_exception();
+                task.upload = [e]() { std::rethrow_exception(e); };
+            }
+            task.decode = nullptr;
+
+            std::lock_guard<std::mutex> lock(q->mutex);
+            q->tasks.push(std::move(task));
+            q->inflight--;
+        });
     }
 }
 
-void asset_loader::add_sub(std::shared_ptr<asset_loader> subloader)
+bool asset_loader::P_idle()
 {
-    subloaders.push_back(subloader);
-    P_total_tcount += subloader->P_total_tcount;
+    {
+        std::lock_guard<std::mutex> lock(P_uploads->mutex);
+        if (!P_pending.empty() || P_uploads->inflight > 0 || !P_uploads->tasks.empty())
+            return false;
+    }
+    for (auto &sub : subloaders)
+    {
+        if (!sub->P_idle())
+            return false;
+    }
+    return true;
 }
 
-void asset_loader::next()
+void asset_loader::P_tally(int &done, int &total) const
 {
-    if (P_end_called)
-        return;
+    done += P_done_tcount;
+    total += P_total_tcount;
+    for (auto &sub : subloaders)
+        sub->P_tally(done, total);
+}
+
+void asset_loader::watch()
+{
+    if (P_watcher == nullptr)
+        P_watcher = file_watcher::make(root);
+}
 
+void asset_loader::P_poll_watcher()
+{
+    for (const path_handle &path : P_watcher->poll())
+    {
+        // the changed file goes through the same strategy as when it was scanned, and its commit
+        // replaces the resource behind the existing handle.
+        P_push({path, nullptr, nullptr}, unique_id(scope, path - root), path.file_format());
+    }
+}
+
+void asset_loader::next()
+{
+    ARC_PROF_ZONE("asset_loader::next");
     if (!P_start_called && event_on_start)
     {
         event_on_start();
         P_start_called = true;
     }
 
-    if (!tasks.empty())
-    {
-        auto fn = tasks.top();
-        tasks.pop();
-        fn();
-        P_done_tcount++;
-        progress = static_cast<double>(P_done_tcount) / static_cast<double>(P_total_tcount);
-    }
-    else
-    {
-        progress = 1;
+    if (P_watcher != nullptr)
+        P_poll_watcher();
 
-        bool can_find = false;
-        for (auto &sub : subloaders)
+    P_dispatch();
+
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        P_asset_task task;
         {
-            if (sub->progress < 1)
-            {
-                sub->next();
-                can_find = true;
+            std::lock_guard<std::mutex> lock(P_uploads->mutex);
+            if (P_uploads->tasks.empty())
                 break;
-            }
-        }
-        if (!can_find)
-        {
-            if (!P_end_called && event_on_end)
-            {
-                event_on_end();
-                free();
-                P_end_called = true;
-            }
+            task = P_uploads->tasks.top();
+            P_uploads->tasks.pop();
         }
+
+        task.upload();
+        P_loaded.insert(task.id);
+        P_done_tcount++;
+
+        std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+        if (spent.count() >= upload_budget)
+            break;
+    }
+
+    // the uploads have made room for more decodes.
+    P_dispatch();
+
+    for (auto &sub : subloaders)
+        sub->next();
+
+    if (!P_end_called && P_idle() && event_on_end)
+    {
+        event_on_end();
+        P_end_called = true;
     }
 }
 
+double asset_loader::progress() const
+{
+    int done = 0;
+    int total = 0;
+    P_tally(done, total);
+    if (total == 0)
+        return 1;
+    return static_cast<double>(done) / static_cast<double>(total);
+}
+
 void asset_loader::free_node(const unique_id &id)
 {
-    P_resource_map.erase(id);
+    res_erase(id);
 }
 
 void asset_loader::free()
 {
-    P_resource_map.clear();
+    for (const unique_id &id : P_loaded)
+        res_erase(id);
+    P_loaded.clear();
 }
 
 asset_loader::~asset_loader()
@@ -112,40 +234,38 @@ std::shared_ptr<asset_loader> asset_loader::make(const std::string &scope, const
     return lptr;
 }
 
+static std::unordered_map<asset_loader_equip, asset_equip_fn> &P_get_asset_equips()
+{
+    static std::unordered_map<asset_loader_equip, asset_equip_fn> equips = {
+        {asset_loader_equip::TXT,
+         [](asset_loader &loader) {
+             loader.async_strategy_map[".txt"] = [](const asset_source &src,
+                                                    const unique_id &id) -> std::function<void()> {
+                 std::string str = src.read_str();
+                 return [str = std::move(str), id]() { res_put(id, str); };
+             };
+         }},
+        {asset_loader_equip::FONT, [](asset_loader &) {}},
+        {asset_loader_equip::SCRIPT, [](asset_loader &) {}},
+        {asset_loader_equip::SHADER, [](asset_loader &) {}},
+    };
+    return equips;
+}
+
+void asset_equip_register(asset_loader_equip equipment, asset_equip_fn fn)
+{
+    P_get_asset_equips()[equipment] = std::move(fn);
+}
+
 void asset_loader::add_equipment(asset_loader_equip equipment)
 {
-    switch (equipment)
+    auto it = P_get_asset_equips().find(equipment);
+    if (it == P_get_asset_equips().end())
     {
-    case asset_loader_equip::PNG_AS_TEXTURE:
-        process_strategy_map[".png"] = [](const path_handle &path, const unique_id &id) {
-            std::shared_ptr<image> img = image::load(path);
-            std::shared_ptr<texture> tex = texture::make(img);
-            P_resource_map[id] = std::any(tex);
-        };
-        break;
-    case asset_loader_equip::PNG_AS_IMAGE:
-        process_strategy_map[".png"] = [](const path_handle &path, const unique_id &id) {
-            std::shared_ptr<image> img = image::load(path);
-            P_resource_map[id] = std::any(img);
-        };
-        break;
-    case asset_loader_equip::TXT:
-        process_strategy_map[".txt"] = [](const path_handle &path, const unique_id &id) {
-            P_resource_map[id] = std::any(io_read_str(path));
-        };
-        break;
-    case asset_loader_equip::WAVE:
-        process_strategy_map[".wav"] = [](const path_handle &path, const unique_id &id) {
-            std::shared_ptr<track> track = track::load(path);
-            P_resource_map[id] = std::any(track);
-        };
-        break;
-    case asset_loader_equip::FONT:
-        break;
-    case asset_loader_equip::SCRIPT:
-    case asset_loader_equip::SHADER:
-        break;
+        print(ARC_WARN, "the asset equipment {} is not available in this build.", static_cast<int>(equipment));
+        return;
     }
+    it->second(*this);
 }
 
 } // namespace arc
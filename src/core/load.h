@@ -1,26 +1,29 @@
 #pragma once
 #include <core/def.h>
 #include <string>
-#include <any>
+#include <atomic>
 #include <unordered_map>
-#include <stack>
+#include <queue>
+#include <mutex>
 #include <functional>
 #include <core/io.h>
 #include <core/uuid.h>
 #include <core/id.h>
+#include <core/pack.h>
+#include <core/res.h>
+#include <core/watch.h>
+#include <unordered_set>
 
 namespace arc
 {
 
-std::unordered_map<unique_id, std::any> &P_get_resource_map();
-
-// get a loaded resource by its id.
-template <typename T> T fetch(const unique_id &id)
+// get a loaded resource by its id, or a default value if absent.
+// it hashes the id, so in per-frame code resolve a #res_handle once by #res_find and keep it.
+template <typename T> std::decay_t<T> fetch(const unique_id &id)
 {
-    const auto &m = P_get_resource_map();
-    auto it = m.find(id);
-    bool cf = it != m.end() && it->second.has_value();
-    return cf ? std::any_cast<T>(it->second) : std::decay_t<T>{};
+    using value_t = std::decay_t<T>;
+    value_t *v = res_find<value_t>(id).get();
+    return v != nullptr ? *v : value_t{};
 }
 
 enum class asset_loader_equip
@@ -34,37 +37,119 @@ enum class asset_loader_equip
     SCRIPT
 };
 
+// where the bytes of an asset come from: a file under the loader root, or an entry of a packed archive.
+struct asset_source
+{
+    path_handle path;
+    /* maybe nullptr */ std::shared_ptr<asset_pack> pack;
+    const asset_pack_entry *entry = nullptr;
+
+    std::vector<uint8_t> read_bytes() const;
+    std::string read_str() const;
+};
+
+struct P_asset_task
+{
+    int priority = 0;
+    uint64_t seq = 0;
+    unique_id id;
+    // the decode stage, run on a worker. it is empty for main-thread-only strategies.
+    std::function<std::function<void()>()> decode;
+    // the commit stage, run on the main thread.
+    std::function<void()> upload;
+
+    bool operator<(const P_asset_task &other) const
+    {
+        // higher priority first, then the earlier scanned.
+        if (priority != other.priority)
+            return priority < other.priority;
+        return seq > other.seq;
+    }
+};
+
+// shared by a loader and its in-flight decode jobs, so that a job never outlives what it reports to.
+struct P_asset_uploads
+{
+    std::mutex mutex;
+    std::priority_queue<P_asset_task> tasks;
+    int inflight = 0;
+};
+
 struct asset_loader
 {
+    // runs on the main thread, and may touch the resource map, gl and al.
     using proc_strategy = std::function<void(const path_handle &path, const unique_id &id)>;
+    // runs on a worker thread, and must not touch the resource map, gl or al.
+    // it returns the job which commits the decoded result on the main thread.
+    using async_strategy = std::function<std::function<void()>(const asset_source &src, const unique_id &id)>;
 
     std::string scope;
     path_handle root;
-    double progress;
-    int P_done_tcount;
-    int P_total_tcount;
+    // tasks scanned later take this priority. the higher ones are decoded and uploaded first.
+    int priority = 0;
+    // the time #next may spend on main-thread uploads per call, in seconds.
+    // at least one upload is run per call, so the loader always makes progress.
+    double upload_budget = 0.004;
+    // when set, the textures of asset_loader_equip::PNG_AS_TEXTURE are packed into shared atlas pages, one set of
+    // pages per tag it returns, so that the sprites of a tag are drawn in one batch. an empty tag keeps a texture on
+    // its own. a packed texture is a cut of its page, so it cannot repeat or have its own parameters.
+    std::function<std::string(const unique_id &id)> atlas_tag;
+    // the side of a shared atlas page. bigger images than half of it on a side are kept on their own.
+    int atlas_page_size = 2048;
+    std::atomic<int> P_done_tcount = 0;
+    std::atomic<int> P_total_tcount = 0;
     std::unordered_map<std::string, proc_strategy> process_strategy_map;
-    std::stack<std::function<void()>> tasks;
+    std::unordered_map<std::string, async_strategy> async_strategy_map;
+    std::priority_queue<P_asset_task> P_pending;
+    std::shared_ptr<P_asset_uploads> P_uploads = std::make_shared<P_asset_uploads>();
+    // the ids committed by this loader, which #free unloads.
+    std::unordered_set<unique_id> P_loaded;
+    std::shared_ptr<file_watcher> P_watcher;
+    uint64_t P_seq = 0;
     std::vector<std::shared_ptr<asset_loader>> subloaders;
     std::function<void()> event_on_start;
     std::function<void()> event_on_end;
-    bool P_start_called;
-    bool P_end_called;
+    bool P_start_called = false;
+    bool P_end_called = false;
 
     ~asset_loader();
 
     void scan(const path_handle &path_root);
+    // queue every entry of a packed archive, as if it was scanned from #root.
+    // custom (main-thread) strategies still get a path, which is #root / key and may not exist.
+    void scan_pack(std::shared_ptr<asset_pack> pack);
     void add_sub(std::shared_ptr<asset_loader> subloader);
-    // run a task in the queue.
-    // you may need to check the #progress to see if all tasks are done.
+    // dispatch decodes to the workers, then run main-thread uploads within #upload_budget.
+    // call it once per frame, and check #progress to see if all tasks are done.
+    // it keeps working after the end event, to apply reloads if #watch is on.
     void next();
+    // watch the files under #root, changed files are reloaded by #next.
+    // resources are replaced behind their handles, and textures are updated in place.
+    void watch();
+    // the ratio of done tasks, including the subloaders'. it can be read from any thread.
+    double progress() const;
+    // unload a resource. if it is still held by a #res_ref, it is unloaded once released.
     void free_node(const unique_id &id);
+    // unload every resource loaded by this loader.
     void free();
 
     // add a built-in loader behavior to the loader.
     void add_equipment(asset_loader_equip equipment);
 
+    void P_poll_watcher();
+    void P_push(const asset_source &src, const unique_id &id, const std::string &fmt);
+    void P_dispatch();
+    bool P_idle();
+    void P_tally(int &done, int &total) const;
+
     static std::shared_ptr<asset_loader> make(const std::string &scope, const path_handle &root);
 };
 
+using asset_equip_fn = std::function<void(asset_loader &loader)>;
+
+// register what #asset_loader::add_equipment does for an equipment.
+// the equipments for gl and al resources are registered by the gfx and audio libraries,
+// so that a headless build links neither.
+void asset_equip_register(asset_loader_equip equipment, asset_equip_fn fn);
+
 } // namespace arc
@@ -1,16 +1,250 @@
+#include <algorithm>
+#include <chrono>
 #include <core/io.h>
 #include <core/log.h>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace arc
 {
 
-static std::ofstream P_logstream = std::ofstream(io_open_local("latest.log").P_npath);
+// drains the rings of all threads on a background thread, and writes to the console & the log file.
+struct P_log_sink
+{
+    std::mutex mutex;
+    // guarded by #mutex, only touched when a thread prints for the first time and once per sink pass.
+    std::vector<std::shared_ptr<P_log_ring>> rings;
+    std::ofstream file;
+    std::thread thread;
+    std::atomic<bool> running = true;
+    // increased after each pass over the rings.
+    std::atomic<uint64_t> epoch = 0;
+    std::atomic<uint64_t> written = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> blocked = 0;
+
+    P_log_sink();
+    ~P_log_sink();
+
+    void P_run();
+    size_t P_drain(std::vector<std::pair<int64_t, std::string>> &batch);
+};
+
+static P_log_sink &P_get_log_sink()
+{
+    // never destroyed, see #P_log_guard.
+    static P_log_sink *sink = new P_log_sink();
+    return *sink;
+}
+
+// stops the sink at exit, after writing what is left. later messages are written synchronously.
+static struct P_log_guard
+{
+    ~P_log_guard()
+    {
+        P_log_sink &sink = P_get_log_sink();
+        P_log_alive = false;
+        sink.running = false;
+        if (sink.thread.joinable())
+            sink.thread.join();
+    }
+} P_log_guard_instance;
+
+P_log_sink::P_log_sink() : file(io_open_local("latest.log").P_npath)
+{
+    thread = std::thread([this]() { P_run(); });
+}
+
+P_log_sink::~P_log_sink() = default;
+
+static void P_log_render(const P_log_record &rec, std::string &out)
+{
+    out = P_get_header(rec.type);
+    switch (rec.kind)
+    {
+    case P_LOG_TEXT:
+        out.append(reinterpret_cast<const char *>(rec.data), rec.len);
+        break;
+    case P_LOG_HEAP: {
+        std::string *str;
+        std::memcpy(&str, rec.data, sizeof(str));
+        out.append(*str);
+        delete str;
+        break;
+    }
+    case P_LOG_DEFERRED:
+        rec.format(rec.data, out);
+        break;
+    }
+}
+
+size_t P_log_sink::P_drain(std::vector<std::pair<int64_t, std::string>> &batch)
+{
+    std::vector<std::shared_ptr<P_log_ring>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // a ring whose thread has exited is dropped once empty, checking #orphan first so that
+        // no message can be pushed between the two checks.
+        std::erase_if(rings, [](const std::shared_ptr<P_log_ring> &r) {
+            return r->orphan.load(std::memory_order_acquire) &&
+                   r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_relaxed);
+        });
+        snapshot = rings;
+    }
+
+    batch.clear();
+    for (const std::shared_ptr<P_log_ring> &ring : snapshot)
+    {
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            const P_log_record &rec = ring->slots[tail & (P_LOG_RING_SIZE - 1)];
+            batch.emplace_back(rec.time, std::string());
+            P_log_render(rec, batch.back().second);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    // interleave the threads by time.
+    std::stable_sort(batch.begin(), batch.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (const auto &[time, text] : batch)
+    {
+        std::cout << text << '\n';
+        log_redirect(text);
+    }
+    if (!batch.empty())
+    {
+        std::cout << std::flush;
+        file << std::flush;
+    }
+    written.fetch_add(batch.size(), std::memory_order_relaxed);
+    return batch.size();
+}
+
+void P_log_sink::P_run()
+{
+    std::vector<std::pair<int64_t, std::string>> batch;
+    while (true)
+    {
+        bool stop = !running.load(std::memory_order_acquire);
+        size_t n = P_drain(batch);
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+        if (stop)
+            break;
+        if (n == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+struct P_log_owner
+{
+    std::shared_ptr<P_log_ring> ring;
+
+    ~P_log_owner()
+    {
+        if (ring != nullptr)
+            ring->orphan.store(true, std::memory_order_release);
+    }
+};
+
+P_log_ring &P_log_local_ring()
+{
+    thread_local P_log_owner owner;
+    if (owner.ring == nullptr)
+    {
+        owner.ring = std::make_shared<P_log_ring>();
+        P_log_sink &sink = P_get_log_sink();
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        sink.rings.push_back(owner.ring);
+    }
+    return *owner.ring;
+}
+
+P_log_record *P_log_acquire(P_log_ring &ring, log_type type)
+{
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) < P_LOG_RING_SIZE)
+        return &ring.slots[head & (P_LOG_RING_SIZE - 1)];
+
+    P_log_sink &sink = P_get_log_sink();
+    if (type < ARC_WARN)
+    {
+        sink.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // warnings and errors are never dropped, wait for the sink.
+    sink.blocked.fetch_add(1, std::memory_order_relaxed);
+    while (head - ring.tail.load(std::memory_order_acquire) >= P_LOG_RING_SIZE)
+    {
+        if (!P_log_alive.load(std::memory_order_relaxed))
+            return nullptr;
+        std::this_thread::yield();
+    }
+    return &ring.slots[head & (P_LOG_RING_SIZE - 1)];
+}
+
+void P_log_sync(log_type type, const std::string &text)
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string formatted = P_get_header(type) + text;
+    std::cout << formatted << std::endl;
+    log_redirect(formatted);
+    P_get_log_sink().file << std::flush;
+}
+
+int64_t P_log_now()
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void log_set_level(log_type type)
+{
+    P_log_level.store(type, std::memory_order_relaxed);
+}
+
+log_type log_get_level()
+{
+    return static_cast<log_type>(P_log_level.load(std::memory_order_relaxed));
+}
+
+log_stats log_get_stats()
+{
+    P_log_sink &sink = P_get_log_sink();
+    log_stats stats;
+    stats.written = sink.written.load(std::memory_order_relaxed);
+    stats.dropped = sink.dropped.load(std::memory_order_relaxed);
+    stats.blocked = sink.blocked.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void log_flush()
+{
+    if (!P_log_alive.load(std::memory_order_relaxed))
+        return;
+    P_log_sink &sink = P_get_log_sink();
+    if (std::this_thread::get_id() == sink.thread.get_id())
+        return;
+    // a pass that started after this call has seen everything printed before it.
+    uint64_t cur = sink.epoch.load(std::memory_order_acquire);
+    uint64_t target = cur + 2;
+    while (cur < target)
+    {
+        sink.epoch.wait(cur, std::memory_order_acquire);
+        cur = sink.epoch.load(std::memory_order_acquire);
+    }
+}
 
 void log_redirect(const std::string &logv)
 {
-    P_logstream << logv << std::endl;
-    P_logstream << std::flush;
+    P_log_sink &sink = P_get_log_sink();
+    sink.file << logv << '\n';
 }
 
 std::string P_get_header(log_type type)
@@ -34,4 +268,4 @@ std::string P_get_header(log_type type)
     return header;
 }
 
-} // namespace arc
\ No newline at end of file
+} // namespace arc
@@ -1,7 +1,15 @@
 #pragma once
+#include <atomic>
 #include <core/def.h>
+#include <cstdint>
+#include <cstring>
 #include <fmt/core.h>
 #include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
 
 namespace arc
 {
@@ -14,28 +22,148 @@ enum log_type
     ARC_FATAL = 3
 };
 
-static std::mutex P_log_mutex;
+struct log_stats
+{
+    // the messages written by the sink.
+    uint64_t written = 0;
+    // the messages discarded because the thread's buffer was full. only debug & info messages are dropped.
+    uint64_t dropped = 0;
+    // the times a thread had to wait for the sink to make room for a warning or an error.
+    uint64_t blocked = 0;
+};
 
+// messages below the level are discarded before their arguments are formatted.
+void log_set_level(log_type type);
+log_type log_get_level();
+log_stats log_get_stats();
+// block until every message printed before the call is written.
+void log_flush();
 void log_redirect(const std::string &logv);
 std::string P_get_header(log_type type);
 
-template <typename... Args> void print(log_type type, const std::string &fmt, Args &&...args)
+inline std::atomic<int> P_log_level = ARC_DEBUG;
+inline std::atomic<bool> P_log_alive = true;
+
+constexpr size_t P_LOG_RECORD_BYTES = 480;
+constexpr uint32_t P_LOG_RING_SIZE = 512;
+
+enum P_log_kind : uint8_t
+{
+    // the formatted text is in the record.
+    P_LOG_TEXT,
+    // the record holds a new std::string, the message was too long.
+    P_LOG_HEAP,
+    // the record holds the format string and the arguments, the sink formats them.
+    P_LOG_DEFERRED
+};
+
+struct P_log_record
+{
+    int64_t time = 0;
+    log_type type = ARC_INFO;
+    P_log_kind kind = P_LOG_TEXT;
+    uint32_t len = 0;
+    void (*format)(const void *data, std::string &out) = nullptr;
+    alignas(8) unsigned char data[P_LOG_RECORD_BYTES];
+};
+
+// a single-producer single-consumer ring, one per printing thread.
+struct P_log_ring
 {
-    std::lock_guard<std::mutex> lock(P_log_mutex);
-    std::string formatted = P_get_header(type) + fmt::format(fmt::runtime(fmt), std::forward<Args>(args)...);
-    std::cout << formatted << std::endl;
-    std::cout << std::flush;
-    log_redirect(formatted);
+    P_log_record slots[P_LOG_RING_SIZE];
+    // written by the owning thread.
+    alignas(64) std::atomic<uint32_t> head = 0;
+    // written by the sink.
+    alignas(64) std::atomic<uint32_t> tail = 0;
+    // the owning thread has exited, the ring is freed once drained.
+    std::atomic<bool> orphan = false;
+};
+
+P_log_ring &P_log_local_ring();
+// wait for a free slot, or count a drop. returns nullptr if the message is dropped.
+P_log_record *P_log_acquire(P_log_ring &ring, log_type type);
+// used when the sink is gone (during static destruction).
+void P_log_sync(log_type type, const std::string &text);
+int64_t P_log_now();
+
+// only plain values are safe to format later, anything else may point at memory the caller frees.
+template <typename T> constexpr bool P_log_deferrable = std::is_arithmetic_v<T>;
+
+template <typename... Args> struct P_log_deferred
+{
+    fmt::string_view fmt;
+    std::tuple<Args...> args;
+
+    static void format(const void *data, std::string &out)
+    {
+        const P_log_deferred &d = *static_cast<const P_log_deferred *>(data);
+        std::apply(
+            [&](const Args &...a) { fmt::vformat_to(std::back_inserter(out), d.fmt, fmt::make_format_args(a...)); },
+            d.args);
+    }
+};
+
+template <typename... Args> void P_log_fill(P_log_record &rec, fmt::string_view fmt, Args &...args)
+{
+    using deferred = P_log_deferred<std::decay_t<Args>...>;
+    if constexpr ((P_log_deferrable<std::decay_t<Args>> && ...) && sizeof(deferred) <= P_LOG_RECORD_BYTES &&
+                  std::is_trivially_destructible_v<deferred>)
+    {
+        new (rec.data) deferred{fmt, std::tuple<std::decay_t<Args>...>(args...)};
+        rec.kind = P_LOG_DEFERRED;
+        rec.format = &deferred::format;
+    }
+    else
+    {
+        char *dst = reinterpret_cast<char *>(rec.data);
+        auto result = fmt::vformat_to_n(dst, P_LOG_RECORD_BYTES, fmt, fmt::make_format_args(args...));
+        if (result.size <= P_LOG_RECORD_BYTES)
+        {
+            rec.kind = P_LOG_TEXT;
+            rec.len = static_cast<uint32_t>(result.size);
+        }
+        else
+        {
+            std::string *str = new std::string(fmt::vformat(fmt, fmt::make_format_args(args...)));
+            std::memcpy(rec.data, &str, sizeof(str));
+            rec.kind = P_LOG_HEAP;
+        }
+    }
+}
+
+// the format string is checked at compile time.
+// it takes no lock and does no io: the message goes into the calling thread's ring, and a background sink writes it.
+// arguments that are plain numbers are formatted by the sink, others are formatted here into the ring.
+template <typename... Args> void print(log_type type, fmt::format_string<Args...> fmt, Args &&...args)
+{
+    if (type < P_log_level.load(std::memory_order_relaxed))
+        return;
+    if (!P_log_alive.load(std::memory_order_relaxed))
+    {
+        P_log_sync(type, fmt::vformat(fmt, fmt::make_format_args(args...)));
+        return;
+    }
+
+    P_log_ring &ring = P_log_local_ring();
+    P_log_record *rec = P_log_acquire(ring, type);
+    if (rec == nullptr)
+        return;
+    rec->time = P_log_now();
+    rec->type = type;
+    P_log_fill(*rec, fmt, args...);
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 }
 
-template <typename... Args> [[noreturn]] void print_throw(log_type type, const std::string &fmt, Args &&...args)
+// the message is written out before throwing.
+template <typename... Args> [[noreturn]] void print_throw(log_type type, fmt::format_string<Args...> fmt, Args &&...args)
 {
-    std::lock_guard<std::mutex> lock(P_log_mutex);
-    std::string formatted = P_get_header(type) + fmt::format(fmt::runtime(fmt), std::forward<Args>(args)...);
-    std::cout << formatted << std::endl;
-    std::cout << std::flush;
-    log_redirect(formatted);
-    throw std::runtime_error(formatted);
+    std::string formatted = fmt::vformat(fmt, fmt::make_format_args(args...));
+    if (type >= P_log_level.load(std::memory_order_relaxed))
+    {
+        print(type, "{}", formatted);
+        log_flush();
+    }
+    throw std::runtime_error(P_get_header(type) + formatted);
 }
 
 } // namespace arc
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <core/buffer.h>
+#include <core/log.h>
+#include <core/pack.h>
+#include <cstdio>
+
+namespace arc
+{
+
+constexpr static uint32_t P_PACK_MAGIC = 0x50435241; // "ARCP"
+constexpr static uint32_t P_PACK_VERSION = 1;
+constexpr static size_t P_PACK_HEADER_BYTES = 24;
+// blobs are aligned, so that a mapped entry can be read in place with no unaligned loads.
+constexpr static uint64_t P_PACK_ALIGN = 16;
+
+uint64_t asset_pack_hash(std::string_view key)
+{
+    return io_hash64(key.data(), key.size());
+}
+
+static bool P_entry_less(const asset_pack_entry &a, const asset_pack_entry &b)
+{
+    if (a.hash != b.hash)
+        return a.hash < b.hash;
+    return a.key < b.key;
+}
+
+const asset_pack_entry *asset_pack::find(std::string_view key) const
+{
+    uint64_t h = asset_pack_hash(key);
+    auto it = std::lower_bound(entries.begin(), entries.end(), h,
+                               [](const asset_pack_entry &e, uint64_t v) { return e.hash < v; });
+    for (; it != entries.end() && it->hash == h; it++)
+    {
+        if (it->key == key)
+            return &*it;
+    }
+    return nullptr;
+}
+
+std::string_view asset_pack::view(const asset_pack_entry &entry) const
+{
+    return P_file->view().substr(entry.offset, entry.size);
+}
+
+std::vector<uint8_t> asset_pack::read(const asset_pack_entry &entry) const
+{
+    std::string_view v = view(entry);
+    std::vector<uint8_t> bytes(v.begin(), v.end());
+    if (entry.codec == asset_pack_codec::BROTLI)
+        bytes = io_decompress(std::move(bytes));
+    if (bytes.size() != entry.raw_size)
+        print_throw(ARC_FATAL, "broken pack entry: {} in {}", entry.key, path.abs_path);
+    return bytes;
+}
+
+std::shared_ptr<asset_pack> asset_pack::open(const path_handle &path)
+{
+    std::shared_ptr<asset_pack> pack = std::make_shared<asset_pack>();
+    pack->path = path;
+    pack->P_file = io_map_file(path);
+
+    const mapped_file &file = *pack->P_file;
+    if (file.size < P_PACK_HEADER_BYTES)
+        print_throw(ARC_FATAL, "not an asset pack: {}", path.abs_path);
+
+    byte_buf head = byte_buf(std::vector<uint8_t>(file.data, file.data + P_PACK_HEADER_BYTES));
+    uint32_t magic = head.read<uint32_t>();
+    uint32_t version = head.read<uint32_t>();
+    uint32_t count = head.read<uint32_t>();
+    head.read<uint32_t>();
+    uint64_t index_offset = head.read<uint64_t>();
+
+    if (magic != P_PACK_MAGIC)
+        print_throw(ARC_FATAL, "not an asset pack: {}", path.abs_path);
+    if (version != P_PACK_VERSION)
+        print_throw(ARC_FATAL, "unsupported asset pack version {}: {}", version, path.abs_path);
+    if (index_offset > file.size)
+        print_throw(ARC_FATAL, "broken asset pack: {}", path.abs_path);
+
+    byte_buf index = byte_buf(std::vector<uint8_t>(file.data + index_offset, file.data + file.size));
+    pack->entries.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        asset_pack_entry e;
+        e.hash = index.read<uint64_t>();
+        e.offset = index.read<uint64_t>();
+        e.size = index.read<uint64_t>();
+        e.raw_size = index.read<uint64_t>();
+        e.codec = static_cast<asset_pack_codec>(index.read<uint8_t>());
+        e.key = index.read_string();
+
+        if (e.offset + e.size > index_offset)
+            print_throw(ARC_FATAL, "broken pack entry: {} in {}", e.key, path.abs_path);
+        pack->entries.push_back(std::move(e));
+    }
+
+    // the packer writes a sorted index, but do not rely on it.
+    if (!std::is_sorted(pack->entries.begin(), pack->entries.end(), P_entry_less))
+        std::sort(pack->entries.begin(), pack->entries.end(), P_entry_less);
+
+    return pack;
+}
+
+static void P_pack_fwrite(std::FILE *f, const void *data, size_t len, const path_handle &out)
+{
+    if (len != 0 && std::fwrite(data, 1, len, f) != len)
+    {
+        std::fclose(f);
+        print_throw(ARC_FATAL, "cannot write asset pack: {}", out.abs_path);
+    }
+}
+
+void asset_pack_write(const path_handle &root, const path_handle &out, bool compress)
+{
+    // write into a temporary file, so that a failed pack never replaces a good one.
+    path_handle tmp = io_open(out.abs_path + ".tmp");
+
+    std::vector<asset_pack_entry> entries;
+    std::vector<path_handle> files;
+    for (const path_handle &path : io_recurse_files(root))
+    {
+        // the archive may be written under the root itself.
+        if (io_judge(path) != path_type::FILE || path.abs_path == out.abs_path || path.abs_path == tmp.abs_path)
+            continue;
+        asset_pack_entry e;
+        e.key = path - root;
+        e.hash = asset_pack_hash(e.key);
+        entries.push_back(std::move(e));
+        files.push_back(path);
+    }
+
+    io_mkdirs(tmp);
+    std::FILE *f = std::fopen(tmp.abs_path.c_str(), "wb");
+    if (f == nullptr)
+        print_throw(ARC_FATAL, "cannot open asset pack: {}", tmp.abs_path);
+
+    std::vector<uint8_t> zeros(P_PACK_HEADER_BYTES, 0);
+    P_pack_fwrite(f, zeros.data(), P_PACK_HEADER_BYTES, tmp);
+    uint64_t pos = P_PACK_HEADER_BYTES;
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        asset_pack_entry &e = entries[i];
+        std::vector<uint8_t> bytes = io_read_bytes(files[i]);
+        e.raw_size = bytes.size();
+
+        if (compress && !bytes.empty())
+        {
+            std::vector<uint8_t> cmp = io_compress(bytes, io_compression_level::SMALLEST);
+            // already-compressed formats would only grow, and would cost a decode at runtime.
+            if (cmp.size() + cmp.size() / 8 < bytes.size())
+            {
+                bytes = std::move(cmp);
+                e.codec = asset_pack_codec::BROTLI;
+            }
+        }
+
+        uint64_t pad = (P_PACK_ALIGN - pos % P_PACK_ALIGN) % P_PACK_ALIGN;
+        P_pack_fwrite(f, zeros.data(), pad, tmp);
+        pos += pad;
+
+        e.offset = pos;
+        e.size = bytes.size();
+        P_pack_fwrite(f, bytes.data(), bytes.size(), tmp);
+        pos += bytes.size();
+    }
+
+    std::sort(entries.begin(), entries.end(), P_entry_less);
+
+    byte_buf index;
+    for (auto &e : entries)
+    {
+        index.write<uint64_t>(e.hash);
+        index.write<uint64_t>(e.offset);
+        index.write<uint64_t>(e.size);
+        index.write<uint64_t>(e.raw_size);
+        index.write<uint8_t>(static_cast<uint8_t>(e.codec));
+        index.write_string(e.key);
+    }
+    P_pack_fwrite(f, index.P_data.data(), index.size(), tmp);
+
+    byte_buf head;
+    head.write<uint32_t>(P_PACK_MAGIC);
+    head.write<uint32_t>(P_PACK_VERSION);
+    head.write<uint32_t>(static_cast<uint32_t>(entries.size()));
+    head.write<uint32_t>(0);
+    head.write<uint64_t>(pos);
+    std::fseek(f, 0, SEEK_SET);
+    P_pack_fwrite(f, head.P_data.data(), head.size(), tmp);
+
+    if (std::fclose(f) != 0)
+        print_throw(ARC_FATAL, "cannot write asset pack: {}", tmp.abs_path);
+    io_rename(tmp, out.abs_path);
+}
+
+} // namespace arc
@@ -0,0 +1,62 @@
+#pragma once
+#include <core/def.h>
+#include <core/io.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace arc
+{
+
+enum class asset_pack_codec : uint8_t
+{
+    NO = 0,
+    BROTLI = 1
+};
+
+struct asset_pack_entry
+{
+    uint64_t hash = 0;
+    uint64_t offset = 0;
+    // the stored size, and the size after decoding.
+    uint64_t size = 0;
+    uint64_t raw_size = 0;
+    asset_pack_codec codec = asset_pack_codec::NO;
+    // the path relative to the packed root, like "gfx/misc/test.png".
+    std::string key;
+};
+
+// a read-only archive of all assets under a root, made offline by the packer (see #asset_pack_write).
+//
+// layout:
+// [header][blobs...][index]
+// the header holds the magic "ARCP", the version, the entry count and the index offset.
+// the index lists every entry as (hash, offset, size, raw size, codec, key), sorted by hash.
+//
+// the archive is memory-mapped, so opening it costs one file open. #view of an uncompressed entry
+// costs no copy at all; #read always copies the bytes out (and decompresses them when needed).
+struct asset_pack
+{
+    path_handle path;
+    std::shared_ptr<mapped_file> P_file;
+    // sorted by hash, then by key.
+    std::vector<asset_pack_entry> entries;
+
+    // returns nullptr if absent.
+    const asset_pack_entry *find(std::string_view key) const;
+    // the stored bytes of an entry, they are compressed unless the codec is NO.
+    std::string_view view(const asset_pack_entry &entry) const;
+    // the decoded bytes of an entry.
+    std::vector<uint8_t> read(const asset_pack_entry &entry) const;
+
+    static std::shared_ptr<asset_pack> open(const path_handle &path);
+};
+
+// the 64-bit fnv-1a hash of a key, which is what the index is sorted by.
+uint64_t asset_pack_hash(std::string_view key);
+// pack every file under #root into one archive.
+// files which do not shrink by compression (like png) are stored as they are.
+void asset_pack_write(const path_handle &root, const path_handle &out, bool compress = true);
+
+} // namespace arc
@@ -0,0 +1,75 @@
+#include <core/pool.h>
+#include <algorithm>
+
+namespace arc
+{
+
+thread_pool::thread_pool(int nthreads)
+{
+    for (int i = 0; i < nthreads; i++)
+        P_workers.emplace_back([this]() { P_work(); });
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(P_mutex);
+        P_stop = true;
+    }
+    P_cv.notify_all();
+    for (auto &t : P_workers)
+        t.join();
+}
+
+void thread_pool::wait()
+{
+    std::unique_lock<std::mutex> lock(P_mutex);
+    P_cv_idle.wait(lock, [this]() { return P_tasks.empty() && P_running == 0; });
+}
+
+size_t thread_pool::pending()
+{
+    std::lock_guard<std::mutex> lock(P_mutex);
+    return P_tasks.size() + P_running;
+}
+
+size_t thread_pool::size() const
+{
+    return P_workers.size();
+}
+
+void thread_pool::P_work()
+{
+    while (true)
+    {
+        std::function<void()> fn;
+        {
+            std::unique_lock<std::mutex> lock(P_mutex);
+            P_cv.wait(lock, [this]() { return P_stop || !P_tasks.empty(); });
+            // drain the queue before stopping, so that no submitted future is left broken.
+            if (P_tasks.empty())
+                return;
+            fn = std::move(P_tasks.front());
+            P_tasks.pop_front();
+            P_running++;
+        }
+
+        fn();
+
+        {
+            std::lock_guard<std::mutex> lock(P_mutex);
+            P_running--;
+            if (P_tasks.empty() && P_running == 0)
+                P_cv_idle.notify_all();
+        }
+    }
+}
+
+std::shared_ptr<thread_pool> thread_pool::make(int nthreads)
+{
+    if (nthreads <= 0)
+        nthreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    return std::make_shared<thread_pool>(nthreads);
+}
+
+} // namespace arc
@@ -0,0 +1,59 @@
+#pragma once
+#include <core/def.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace arc
+{
+
+// a fixed-size worker pool.
+// tasks are run in submission order, results and exceptions are reported via futures.
+struct thread_pool
+{
+    std::vector<std::thread> P_workers;
+    std::deque<std::function<void()>> P_tasks;
+    std::mutex P_mutex;
+    std::condition_variable P_cv;
+    std::condition_variable P_cv_idle;
+    int P_running = 0;
+    bool P_stop = false;
+
+    thread_pool(int nthreads);
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+    // waits for the queued tasks to finish.
+    ~thread_pool();
+
+    template <typename F> auto submit(F &&fn) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using ret_t = std::invoke_result_t<std::decay_t<F>>;
+        // std::function needs a copyable callable, while packaged_task is move-only.
+        auto task = std::make_shared<std::packaged_task<ret_t()>>(std::forward<F>(fn));
+        std::future<ret_t> fut = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(P_mutex);
+            P_tasks.emplace_back([task]() { (*task)(); });
+        }
+        P_cv.notify_one();
+        return fut;
+    }
+
+    // block until the queue is drained and no task is running.
+    void wait();
+    // the count of queued and running tasks.
+    size_t pending();
+    size_t size() const;
+
+    void P_work();
+
+    // if #nthreads is not positive, the pool will use (hardware threads - 1), at least 1.
+    static std::shared_ptr<thread_pool> make(int nthreads = 0);
+};
+
+} // namespace arc
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <chrono>
+#include <core/log.h>
+#include <core/prof.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace arc
+{
+
+struct P_prof_state
+{
+    std::mutex mutex;
+    // rings are kept after their threads exit, so that their events can still be exported.
+    std::vector<std::shared_ptr<P_prof_ring>> rings;
+    int next_tid = 0;
+};
+
+static P_prof_state &P_get_prof_state()
+{
+    static P_prof_state *state = new P_prof_state();
+    return *state;
+}
+
+P_prof_ring &P_prof_local_ring()
+{
+    thread_local std::shared_ptr<P_prof_ring> ring;
+    if (ring == nullptr)
+    {
+        ring = std::make_shared<P_prof_ring>();
+        P_prof_state &state = P_get_prof_state();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        ring->tid = state.next_tid++;
+        state.rings.push_back(ring);
+    }
+    return *ring;
+}
+
+int64_t P_prof_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void prof_set_enabled(bool enabled)
+{
+    P_prof_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool prof_is_enabled()
+{
+    return P_prof_enabled.load(std::memory_order_relaxed);
+}
+
+void prof_clear()
+{
+    P_prof_state &state = P_get_prof_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (auto &ring : state.rings)
+        ring->from.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+// copy the valid events of a ring, which may still be written by its thread.
+static void P_prof_collect(const P_prof_ring &ring, std::vector<prof_event> &out)
+{
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t first = head > P_prof_ring::SIZE ? head - P_prof_ring::SIZE : 0;
+    first = std::max(first, ring.from.load(std::memory_order_relaxed));
+    size_t base = out.size();
+    for (uint64_t i = first; i < head; i++)
+        out.push_back(ring.events[i & (P_prof_ring::SIZE - 1)]);
+
+    // events overwritten during the copy are dropped, including the one being written now.
+    uint64_t now = ring.head.load(std::memory_order_acquire) + 1;
+    uint64_t lost = now > P_prof_ring::SIZE + first ? now - P_prof_ring::SIZE - first : 0;
+    lost = std::min<uint64_t>(lost, head - first);
+    out.erase(out.begin() + base, out.begin() + base + lost);
+}
+
+void prof_export(const path_handle &path)
+{
+    P_prof_state &state = P_get_prof_state();
+    std::vector<std::shared_ptr<P_prof_ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        rings = state.rings;
+    }
+
+    fmt::memory_buffer buf;
+    auto out = std::back_inserter(buf);
+    fmt::format_to(out, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool first = true;
+    std::vector<prof_event> events;
+    for (const auto &ring : rings)
+    {
+        events.clear();
+        P_prof_collect(*ring, events);
+
+        for (const prof_event &e : events)
+        {
+            if (!first)
+                fmt::format_to(out, ",");
+            first = false;
+            double ts = e.start / 1000.0;
+            if (e.duration < 0)
+                fmt::format_to(out, "\n{{\"name\":\"{}\",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":0,\"tid\":{},\"args\":{{\"value\":{}}}}}",
+                               e.name, ts, ring->tid, e.value);
+            else
+                fmt::format_to(out, "\n{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":0,\"tid\":{}}}",
+                               e.name, ts, e.duration / 1000.0, ring->tid);
+        }
+    }
+    fmt::format_to(out, "\n]}}\n");
+
+    std::ofstream file(path.P_npath, std::ios::binary);
+    if (!file)
+    {
+        print(ARC_WARN, "cannot write the trace to {}.", path.abs_path);
+        return;
+    }
+    file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    print(ARC_INFO, "wrote the trace to {}.", path.abs_path);
+}
+
+} // namespace arc
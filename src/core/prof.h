@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <core/def.h>
+#include <core/io.h>
+#include <cstdint>
+
+namespace arc
+{
+
+// the profiler is compiled in with ARC_PROFILE defined (cmake -DARC_PROFILE=ON).
+// without it, the macros below expand to nothing, and the functions record nothing.
+//
+// ARC_PROF_ZONE("name") times the rest of the enclosing scope.
+// ARC_PROF_COUNTER("name", value) records a value over time.
+// names must be string literals, or otherwise outlive the profiler.
+
+struct prof_event
+{
+    const char *name = nullptr;
+    int64_t start = 0;
+    // negative for a counter.
+    int64_t duration = 0;
+    double value = 0.0;
+};
+
+// the events of one thread. the oldest are overwritten when it is full.
+struct P_prof_ring
+{
+    constexpr static uint32_t SIZE = 1u << 15;
+
+    prof_event events[SIZE];
+    std::atomic<uint64_t> head = 0;
+    // events before it were cleared.
+    std::atomic<uint64_t> from = 0;
+    int tid = 0;
+};
+
+inline std::atomic<bool> P_prof_enabled = true;
+
+P_prof_ring &P_prof_local_ring();
+int64_t P_prof_now();
+
+// pause or resume recording at runtime.
+void prof_set_enabled(bool enabled);
+bool prof_is_enabled();
+// forget everything recorded so far.
+void prof_clear();
+// write what is recorded as chrome trace json, it can be opened in chrome://tracing or perfetto.
+void prof_export(const path_handle &path);
+
+inline void P_prof_push(const char *name, int64_t start, int64_t duration, double value)
+{
+    P_prof_ring &ring = P_prof_local_ring();
+    uint64_t h = ring.head.load(std::memory_order_relaxed);
+    ring.events[h & (P_prof_ring::SIZE - 1)] = {name, start, duration, value};
+    ring.head.store(h + 1, std::memory_order_release);
+}
+
+struct prof_zone
+{
+    const char *name;
+    int64_t start;
+
+    prof_zone(const char *name) : name(name), start(P_prof_now())
+    {
+    }
+
+    ~prof_zone()
+    {
+        if (P_prof_enabled.load(std::memory_order_relaxed))
+            P_prof_push(name, start, P_prof_now() - start, 0.0);
+    }
+
+    prof_zone(const prof_zone &) = delete;
+    prof_zone &operator=(const prof_zone &) = delete;
+};
+
+inline void prof_counter(const char *name, double value)
+{
+    if (P_prof_enabled.load(std::memory_order_relaxed))
+        P_prof_push(name, P_prof_now(), -1, value);
+}
+
+} // namespace arc
+
+#define P_PROF_CAT2(a, b) a##b
+#define P_PROF_CAT(a, b) P_PROF_CAT2(a, b)
+
+#ifdef ARC_PROFILE
+#define ARC_PROF_ZONE(name) ::arc::prof_zone P_PROF_CAT(P_prof_zone_, __LINE__)(name)
+#define ARC_PROF_COUNTER(name, value) ::arc::prof_counter(name, static_cast<double>(value))
+#else
+#define ARC_PROF_ZONE(name) ((void)0)
+#define ARC_PROF_COUNTER(name, value) ((void)0)
+#endif
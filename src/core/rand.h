@@ -1,6 +1,7 @@
 #pragma once
 #include <core/def.h>
 #include <core/buffer.h>
+#include <memory>
 
 namespace arc
 {
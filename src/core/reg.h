@@ -1,61 +1,215 @@
 #pragma once
 #include <core/def.h>
-#include <stack>
-#include <map>
-#include <functional>
 #include <core/id.h>
+#include <core/log.h>
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
 namespace arc
 {
 
 template <typename T> struct registry;
 
+// a typed index into a registry. it is as cheap as an int, and it never copies the value.
 template <typename T> struct ref
 {
-    registry<T> &reg;
-    int idx;
+    const registry<T> *reg = nullptr;
+    uint32_t idx = UINT32_MAX;
 
-    operator T()
+    bool valid() const
     {
-        return reg[idx];
+        return reg != nullptr && idx != UINT32_MAX;
+    }
+
+    const T &get() const
+    {
+        return reg->data[idx];
+    }
+
+    operator const T &() const
+    {
+        return get();
+    }
+
+    const T *operator->() const
+    {
+        return &get();
+    }
+
+    bool operator==(const ref &other) const
+    {
+        return idx == other.idx && reg == other.reg;
     }
 };
 
+// a two-phase registry.
+// in the build phase, #make accepts registrations, and each gets the next index.
+// #freeze then ends the build phase, and builds a perfect hash table from the ids to the indices,
+// so a lookup by id is two array reads and an integer compare. the values are stored contiguously in #data.
+// look values up by id once, and keep their #ref for the hot paths.
 template <typename T> struct registry
 {
-    std::map<unique_id, T> map;
-    std::stack<std::function<void()>> P_delayed;
-    int P_idx_next = 0;
+    std::vector<T> data;
+    std::vector<unique_id> ids;
+    bool frozen = false;
+    // the build phase index.
+    std::unordered_map<unique_id, uint32_t> P_build_index;
+    // the perfect hash: a seed per bucket, then a slot per value.
+    std::vector<uint32_t> P_seeds;
+    std::vector<uint32_t> P_slots;
+    uint64_t P_mask = 0;
+
+    // if the value has members reg_index & reg_id, they are filled in.
+    ref<T> make(const unique_id &id, T obj)
+    {
+        if (frozen)
+            print_throw(ARC_FATAL, "registry is frozen, cannot register {}.", id.concat());
+        if (P_build_index.find(id) != P_build_index.end())
+            print_throw(ARC_FATAL, "duplicated registration of {}.", id.concat());
+
+        uint32_t idx = static_cast<uint32_t>(data.size());
+        if constexpr (requires { obj.reg_index = static_cast<int>(idx); })
+            obj.reg_index = static_cast<int>(idx);
+        if constexpr (requires { obj.reg_id = id; })
+            obj.reg_id = id;
+
+        data.push_back(std::move(obj));
+        ids.push_back(id);
+        P_build_index[id] = idx;
+        return {this, idx};
+    }
+
+    static uint64_t P_mix(uint64_t h, uint32_t seed)
+    {
+        // splitmix64 finalizer.
+        h ^= (static_cast<uint64_t>(seed) + 1) * 0x9e3779b97f4a7c15ull;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+    }
+
+    uint32_t P_bucket(uint64_t h) const
+    {
+        return static_cast<uint32_t>((h >> 32) % P_seeds.size());
+    }
+
+    // how many seeds a bucket tries before the table is made larger.
+    constexpr static uint32_t P_SEED_MAX = 1u << 16;
 
-    ref<T> make(const unique_id &id, const T &obj)
+    // end the build phase. lookups before it go through a hash map, and are slower.
+    void freeze()
     {
-        map[id] = obj;
-        int idx = P_idx_next++;
-        // here, the template value should have members reg_index & reg_id.
-        P_delayed.push([this, idx, id]() {
-            map[id].reg_index = idx;
-            map[id].reg_id = id;
-        });
-        return {*this, idx};
+        if (frozen)
+            return;
+
+        // no seed can tell apart two ids with the same hash.
+        size_t n = data.size();
+        std::vector<uint32_t> by_hash(n);
+        for (uint32_t i = 0; i < n; i++)
+            by_hash[i] = i;
+        std::sort(by_hash.begin(), by_hash.end(),
+                  [&](uint32_t a, uint32_t b) { return ids[a].P_hash < ids[b].P_hash; });
+        for (size_t i = 1; i < n; i++)
+            if (ids[by_hash[i - 1]].P_hash == ids[by_hash[i]].P_hash)
+                print_throw(ARC_FATAL, "{} and {} have the same hash, rename one of them.",
+                            ids[by_hash[i - 1]].concat(), ids[by_hash[i]].concat());
+
+        size_t m = 1;
+        while (m < n)
+            m <<= 1;
+        while (!P_place(m))
+            m <<= 1;
+
+        frozen = true;
+        P_build_index.clear();
     }
 
-    void work()
+    // hash and displace into #m slots: place the largest buckets first, each with the first seed that lands
+    // all of its keys on free slots. false if a bucket finds no seed.
+    bool P_place(size_t m)
     {
-        while (!P_delayed.empty())
+        size_t n = data.size();
+        P_mask = m - 1;
+        P_slots.assign(m, UINT32_MAX);
+        P_seeds.assign(std::max<size_t>(1, n / 4 + 1), 0);
+
+        std::vector<std::vector<uint32_t>> buckets(P_seeds.size());
+        for (uint32_t i = 0; i < n; i++)
+            buckets[P_bucket(ids[i].P_hash)].push_back(i);
+
+        std::vector<uint32_t> order(buckets.size());
+        for (uint32_t b = 0; b < order.size(); b++)
+            order[b] = b;
+        std::sort(order.begin(), order.end(),
+                  [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<uint64_t> placed;
+        for (uint32_t b : order)
         {
-            P_delayed.top()();
-            P_delayed.pop();
+            if (buckets[b].empty())
+                break;
+            bool ok = false;
+            for (uint32_t seed = 0; seed < P_SEED_MAX && !ok; seed++)
+            {
+                placed.clear();
+                ok = true;
+                for (uint32_t i : buckets[b])
+                {
+                    uint64_t s = P_mix(ids[i].P_hash, seed) & P_mask;
+                    if (P_slots[s] != UINT32_MAX || std::find(placed.begin(), placed.end(), s) != placed.end())
+                    {
+                        ok = false;
+                        break;
+                    }
+                    placed.push_back(s);
+                }
+                if (ok)
+                {
+                    for (size_t k = 0; k < placed.size(); k++)
+                        P_slots[placed[k]] = buckets[b][k];
+                    P_seeds[b] = seed;
+                }
+            }
+            if (!ok)
+                return false;
         }
+        return true;
+    }
+
+    // returns an invalid ref if absent.
+    ref<T> find(const unique_id &id) const
+    {
+        if (!frozen)
+        {
+            auto it = P_build_index.find(id);
+            return it == P_build_index.end() ? ref<T>() : ref<T>{this, it->second};
+        }
+        if (data.empty())
+            return {};
+        uint32_t idx = P_slots[P_mix(id.P_hash, P_seeds[P_bucket(id.P_hash)]) & P_mask];
+        if (idx == UINT32_MAX || !(ids[idx] == id))
+            return {};
+        return {this, idx};
+    }
+
+    size_t size() const
+    {
+        return data.size();
     }
 
-    T operator[](int idx)
+    const T &operator[](uint32_t idx) const
     {
-        return map[idx];
+        return data[idx];
     }
 
-    T operator[](const unique_id &id)
+    const T &operator[](const unique_id &id) const
     {
-        return map[id];
+        ref<T> r = find(id);
+        if (!r.valid())
+            print_throw(ARC_FATAL, "not registered: {}.", id.concat());
+        return r.get();
     }
 };
 
@@ -0,0 +1,34 @@
+#include <core/res.h>
+
+namespace arc
+{
+
+std::vector<res_table_terased *> &P_get_res_tables()
+{
+    static std::vector<res_table_terased *> tables;
+    return tables;
+}
+
+bool res_has(const unique_id &id)
+{
+    for (res_table_terased *t : P_get_res_tables())
+    {
+        if (t->has(id))
+            return true;
+    }
+    return false;
+}
+
+void res_erase(const unique_id &id)
+{
+    for (res_table_terased *t : P_get_res_tables())
+        t->erase(id);
+}
+
+void res_clear()
+{
+    for (res_table_terased *t : P_get_res_tables())
+        t->clear();
+}
+
+} // namespace arc
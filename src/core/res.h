@@ -0,0 +1,237 @@
+#pragma once
+#include <core/def.h>
+#include <core/id.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace arc
+{
+
+// a stable reference to a resource in a #res_table.
+// it is resolved once by id, after that every access is an index and a generation check, with no string hashing.
+// a handle to an unloaded resource is stale, and resolves to nullptr instead of to whatever reuses its slot.
+template <typename T> struct res_handle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != UINT32_MAX;
+    }
+
+    T *get() const;
+};
+
+struct res_table_terased
+{
+    virtual ~res_table_terased() = default;
+
+    virtual bool has(const unique_id &id) const = 0;
+    // unload a resource. if it is still referenced by a #res_ref, it is unloaded when the last one is released.
+    virtual void erase(const unique_id &id) = 0;
+    virtual void clear() = 0;
+};
+
+std::vector<res_table_terased *> &P_get_res_tables();
+
+// the resources of one type. there is one table per type, see #instance.
+// tables are not thread-safe, they should only be touched on the main thread (asset loaders commit there).
+template <typename T> struct res_table : res_table_terased
+{
+    struct P_slot
+    {
+        T value{};
+        unique_id id;
+        uint32_t generation = 1;
+        int refs = 0;
+        bool alive = false;
+        // erased while referenced, unload on the last release.
+        bool P_unload = false;
+    };
+
+    std::vector<P_slot> slots;
+    std::vector<uint32_t> P_free;
+    std::unordered_map<unique_id, uint32_t> P_index;
+
+    // add a resource, or replace the value of an existing one in place, so that its handles stay valid.
+    res_handle<T> put(const unique_id &id, T value)
+    {
+        auto it = P_index.find(id);
+        if (it != P_index.end())
+        {
+            P_slot &s = slots[it->second];
+            s.value = std::move(value);
+            return {it->second, s.generation};
+        }
+
+        uint32_t idx;
+        if (!P_free.empty())
+        {
+            idx = P_free.back();
+            P_free.pop_back();
+        }
+        else
+        {
+            idx = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+
+        P_slot &s = slots[idx];
+        s.value = std::move(value);
+        s.id = id;
+        s.alive = true;
+        s.P_unload = false;
+        s.refs = 0;
+        P_index[id] = idx;
+        return {idx, s.generation};
+    }
+
+    // resolve an id to a handle, or an invalid handle if absent. keep the handle instead of resolving per frame.
+    res_handle<T> find(const unique_id &id) const
+    {
+        auto it = P_index.find(id);
+        if (it == P_index.end())
+            return {};
+        return {it->second, slots[it->second].generation};
+    }
+
+    T *get(res_handle<T> h)
+    {
+        if (h.index >= slots.size())
+            return nullptr;
+        P_slot &s = slots[h.index];
+        if (!s.alive || s.generation != h.generation)
+            return nullptr;
+        return &s.value;
+    }
+
+    void acquire(res_handle<T> h)
+    {
+        if (get(h) != nullptr)
+            slots[h.index].refs++;
+    }
+
+    void release(res_handle<T> h)
+    {
+        if (get(h) == nullptr)
+            return;
+        P_slot &s = slots[h.index];
+        if (--s.refs <= 0 && s.P_unload)
+            P_drop(h.index);
+    }
+
+    bool has(const unique_id &id) const override
+    {
+        return P_index.find(id) != P_index.end();
+    }
+
+    void erase(const unique_id &id) override
+    {
+        auto it = P_index.find(id);
+        if (it == P_index.end())
+            return;
+        uint32_t idx = it->second;
+        // new lookups miss at once, while the held references keep working.
+        P_index.erase(it);
+        if (slots[idx].refs > 0)
+            slots[idx].P_unload = true;
+        else
+            P_drop(idx);
+    }
+
+    void clear() override
+    {
+        std::vector<unique_id> ids;
+        ids.reserve(P_index.size());
+        for (auto &kv : P_index)
+            ids.push_back(kv.first);
+        for (auto &id : ids)
+            erase(id);
+    }
+
+    void P_drop(uint32_t idx)
+    {
+        P_slot &s = slots[idx];
+        s.value = T{};
+        s.alive = false;
+        s.P_unload = false;
+        s.refs = 0;
+        // invalidates every handle to the old resource.
+        s.generation++;
+        P_free.push_back(idx);
+    }
+
+    static res_table<T> &instance()
+    {
+        static res_table<T> *table = []() {
+            // never destroyed, as resources may be released during static destruction.
+            res_table<T> *t = new res_table<T>();
+            P_get_res_tables().push_back(t);
+            return t;
+        }();
+        return *table;
+    }
+};
+
+template <typename T> T *res_handle<T>::get() const
+{
+    return res_table<T>::instance().get(*this);
+}
+
+// a counted reference to a resource, which defers its unloading until released.
+template <typename T> struct res_ref
+{
+    res_handle<T> handle;
+
+    res_ref() = default;
+
+    res_ref(res_handle<T> h) : handle(h)
+    {
+        res_table<T>::instance().acquire(handle);
+    }
+
+    res_ref(const res_ref &other) : res_ref(other.handle)
+    {
+    }
+
+    res_ref &operator=(const res_ref &other)
+    {
+        if (this != &other)
+        {
+            res_table<T>::instance().acquire(other.handle);
+            res_table<T>::instance().release(handle);
+            handle = other.handle;
+        }
+        return *this;
+    }
+
+    ~res_ref()
+    {
+        res_table<T>::instance().release(handle);
+    }
+
+    T *get() const
+    {
+        return handle.get();
+    }
+};
+
+template <typename T> res_handle<T> res_put(const unique_id &id, T value)
+{
+    return res_table<T>::instance().put(id, std::move(value));
+}
+
+template <typename T> res_handle<T> res_find(const unique_id &id)
+{
+    return res_table<T>::instance().find(id);
+}
+
+// true if any table holds the id.
+bool res_has(const unique_id &id);
+// unload the id from every table.
+void res_erase(const unique_id &id);
+void res_clear();
+
+} // namespace arc
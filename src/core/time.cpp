@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <chrono>
+#include <core/log.h>
 #include <core/time.h>
-#include <gfx/device.h>
+#include <thread>
 
 namespace arc
 {
@@ -35,4 +38,32 @@ double lerp(double old, double now)
     return old + P_clock.partial * (now - old);
 }
 
+void tick_lifecycle(int tps, const std::function<void()> &tick, const std::function<bool()> &should_stop)
+{
+    if (tps <= 0)
+        print_throw(ARC_FATAL, "the tick rate must be positive, but it is {}.", tps);
+
+    using clk = std::chrono::steady_clock;
+    const clk::duration dt = std::chrono::duration_cast<clk::duration>(std::chrono::duration<double>(1.0 / tps));
+
+    P_clock.delta = 1.0 / tps;
+    clk::time_point next = clk::now();
+
+    while (!should_stop())
+    {
+        int max_catch = 4;
+        while (clk::now() >= next && max_catch--)
+        {
+            tick();
+            P_clock.ticks++;
+            P_clock.seconds += P_clock.delta;
+            next += dt;
+        }
+        // drop the ticks that cannot be caught up, instead of spiraling.
+        if (clk::now() >= next)
+            next = clk::now();
+        std::this_thread::sleep_until(next);
+    }
+}
+
 } // namespace arc
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 
 namespace arc
 {
@@ -27,4 +28,10 @@ struct clock
 
 double lerp(double old, double now);
 
+// the fixed-rate tick loop of #tk_lifecycle, without a window or rendering, for headless servers.
+// it runs #tick #tps times per second, catching up at most a few ticks after a stall,
+// and sleeps in between. it returns when #should_stop returns true, which is checked every loop.
+// #tps must be positive.
+void tick_lifecycle(int tps, const std::function<void()> &tick, const std::function<bool()> &should_stop);
+
 } // namespace arc
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <core/log.h>
+#include <core/watch.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace arc
+{
+
+file_watcher::~file_watcher()
+{
+#ifdef __linux__
+    if (P_fd != -1)
+        close(P_fd);
+#endif
+}
+
+void file_watcher::P_watch_dir(const std::string &dir)
+{
+#ifdef __linux__
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+    int wd = inotify_add_watch(P_fd, dir.c_str(), mask);
+    if (wd < 0)
+    {
+        print(ARC_WARN, "cannot watch {}", dir);
+        return;
+    }
+    P_wds[wd] = dir;
+
+    for (const path_handle &sub : io_sub_dirs(path_handle(dir)))
+        P_watch_dir(sub.abs_path);
+#endif
+}
+
+void file_watcher::P_read_events()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buf[4096];
+    while (true)
+    {
+        ssize_t len = read(P_fd, buf, sizeof(buf));
+        if (len <= 0)
+            break;
+
+        for (char *p = buf; p < buf + len;)
+        {
+            const inotify_event *ev = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            auto it = P_wds.find(ev->wd);
+            if (it == P_wds.end())
+                continue;
+            if (ev->mask & IN_DELETE_SELF)
+            {
+                P_wds.erase(it);
+                continue;
+            }
+            if (ev->len == 0)
+                continue;
+
+            std::string path = it->second + "/" + ev->name;
+            if (ev->mask & IN_ISDIR)
+            {
+                // a new directory, watch it and report what was already written into it.
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    P_watch_dir(path);
+                    for (const path_handle &f : io_recurse_files(path_handle(path)))
+                        P_changed[f.abs_path] = clock::now();
+                }
+                continue;
+            }
+            // a created file is reported by its close-write.
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                P_changed[path] = clock::now();
+        }
+    }
+#endif
+}
+
+void file_watcher::P_scan_mtimes(bool report)
+{
+    for (const path_handle &path : io_recurse_files(root))
+    {
+        std::error_code ec;
+        fs::file_time_type t = fs::last_write_time(path.P_npath, ec);
+        if (ec)
+            continue;
+
+        auto it = P_mtimes.find(path.abs_path);
+        if (it == P_mtimes.end() || it->second != t)
+        {
+            if (report)
+                P_changed[path.abs_path] = clock::now();
+            P_mtimes[path.abs_path] = t;
+        }
+    }
+    P_last_scan = clock::now();
+}
+
+std::vector<path_handle> file_watcher::poll()
+{
+    if (P_fd != -1)
+        P_read_events();
+    else if (clock::now() - P_last_scan > std::chrono::milliseconds(500))
+        P_scan_mtimes(true);
+
+    std::vector<path_handle> out;
+    clock::time_point now = clock::now();
+    for (auto it = P_changed.begin(); it != P_changed.end();)
+    {
+        std::chrono::duration<double> quiet = now - it->second;
+        if (quiet.count() < settle)
+        {
+            it++;
+            continue;
+        }
+        if (io_judge(path_handle(it->first)) == path_type::FILE)
+            out.push_back(path_handle(it->first));
+        it = P_changed.erase(it);
+    }
+    return out;
+}
+
+std::shared_ptr<file_watcher> file_watcher::make(const path_handle &root)
+{
+    std::shared_ptr<file_watcher> w = std::make_shared<file_watcher>();
+    w->root = root;
+#ifdef __linux__
+    w->P_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->P_fd != -1)
+    {
+        w->P_watch_dir(root.abs_path);
+        return w;
+    }
+    print(ARC_WARN, "inotify is unavailable, falling back to polling.");
+#endif
+    w->P_scan_mtimes(false);
+    return w;
+}
+
+} // namespace arc
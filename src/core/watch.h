@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <core/def.h>
+#include <core/io.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace arc
+{
+
+// watches the files under a directory, recursively.
+// on linux it is backed by inotify, elsewhere it falls back to comparing modification times.
+struct file_watcher
+{
+    using clock = std::chrono::steady_clock;
+
+    path_handle root;
+    // a file is reported once it has not changed for this long, so that an editor saving
+    // in several steps (truncate, write, rename) causes one reload of a complete file.
+    double settle = 0.1;
+    // the pending changes, with the time of their last event.
+    std::unordered_map<std::string, clock::time_point> P_changed;
+    int P_fd = -1;
+    std::unordered_map<int, std::string> P_wds;
+    std::unordered_map<std::string, fs::file_time_type> P_mtimes;
+    clock::time_point P_last_scan;
+
+    file_watcher() = default;
+    file_watcher(const file_watcher &) = delete;
+    file_watcher &operator=(const file_watcher &) = delete;
+    ~file_watcher();
+
+    // get the files changed since the last call. it does not block.
+    std::vector<path_handle> poll();
+
+    void P_watch_dir(const std::string &dir);
+    void P_read_events();
+    void P_scan_mtimes(bool report);
+
+    static std::shared_ptr<file_watcher> make(const path_handle &root);
+};
+
+} // namespace arc
@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <core/log.h>
 #include <core/math.h>
+#include <cstring>
 #include <gfx/atlas.h>
 #include <gfx/image.h>
+#include <string>
+#include <unordered_map>
 
 
 #define PADDING 1
@@ -12,7 +15,7 @@ namespace arc::gfx
 
 struct atlas::P_impl
 {
-    std::vector<quad> free_rects;
+    std::vector<P_skyline_node> skyline;
 };
 
 // for unique_ptr<P_impl> to refer
@@ -24,10 +27,76 @@ atlas::atlas(int w, int h)
 // for unique_ptr<P_impl> to refer
 atlas::~atlas() = default;
 
+// the lowest y at which #w x #h fits with its left edge at node #i, or -1.
+static int P_skyline_fit(const std::vector<P_skyline_node> &sky, size_t i, int w, int h, int size_w, int size_h)
+{
+    if (sky[i].x + w > size_w)
+        return -1;
+    int y = 0;
+    for (int left = w; left > 0; i++)
+    {
+        y = std::max(y, sky[i].y);
+        if (y + h > size_h)
+            return -1;
+        left -= sky[i].width;
+    }
+    return y;
+}
+
+bool P_skyline_insert(std::vector<P_skyline_node> &sky, int w, int h, int size_w, int size_h, int &ox, int &oy)
+{
+    int best = -1, best_y = INT_MAX, best_w = INT_MAX;
+    for (size_t i = 0; i < sky.size(); i++)
+    {
+        // a node at or above the best height cannot give a lower position.
+        if (sky[i].y > best_y || (sky[i].y == best_y && sky[i].width >= best_w))
+            continue;
+        int y = P_skyline_fit(sky, i, w, h, size_w, size_h);
+        if (y < 0)
+            continue;
+        if (y < best_y || (y == best_y && sky[i].width < best_w))
+            best = static_cast<int>(i), best_y = y, best_w = sky[i].width;
+    }
+    if (best < 0)
+        return false;
+
+    ox = sky[best].x;
+    oy = best_y;
+    sky.insert(sky.begin() + best, {ox, oy + h, w});
+
+    // cut the nodes now covered by the new one.
+    size_t first = best + 1, last = first;
+    while (last < sky.size())
+    {
+        P_skyline_node &n = sky[last];
+        int cover = ox + w - n.x;
+        if (cover <= 0)
+            break;
+        n.x += cover;
+        n.width -= cover;
+        if (n.width > 0)
+            break;
+        last++;
+    }
+    sky.erase(sky.begin() + first, sky.begin() + last);
+
+    // only the new node can be level with its neighbours.
+    if (static_cast<size_t>(best) + 1 < sky.size() && sky[best + 1].y == sky[best].y)
+    {
+        sky[best].width += sky[best + 1].width;
+        sky.erase(sky.begin() + best + 1);
+    }
+    if (best > 0 && sky[best - 1].y == sky[best].y)
+    {
+        sky[best - 1].width += sky[best].width;
+        sky.erase(sky.begin() + best);
+    }
+    return true;
+}
+
 void atlas::begin()
 {
-    P_p->free_rects.clear();
-    P_p->free_rects.push_back(quad(0, 0, width, height));
+    P_p->skyline.assign(1, {0, 0, width});
 
     output_image = image::make(width, height, pixels);
     output_texture = texture::make(nullptr);
@@ -48,97 +117,151 @@ std::shared_ptr<texture> atlas::accept(std::shared_ptr<image> image)
 {
     if (!image || !image->pixels)
         return nullptr;
-    int rw = image->width;
-    int rh = image->height;
+    std::shared_ptr<texture> tex = P_try_accept(image);
+    if (tex == nullptr)
+        print_throw(ARC_FATAL, "atlas is not big enough. please expand it.");
+    return tex;
+}
 
-    std::vector<quad> &free_rects = P_p->free_rects;
+std::vector<std::shared_ptr<texture>> atlas::accept_all(const std::vector<std::shared_ptr<image>> &images)
+{
+    // the tallest first, then the widest, so that each row of the skyline is filled by images of a similar height.
+    std::vector<size_t> order;
+    for (size_t i = 0; i < images.size(); i++)
+        if (images[i] && images[i]->pixels)
+            order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (images[a]->height != images[b]->height)
+            return images[a]->height > images[b]->height;
+        return images[a]->width > images[b]->width;
+    });
 
-    int best = -1, best_score = INT_MAX;
-    for (size_t i = 0; i < free_rects.size(); ++i)
-    {
-        const quad &fr = free_rects[i];
-        if (fr.width < rw || fr.height < rh)
-            continue;
-        int score = std::min(fr.width - rw, fr.height - rh);
-        if (score < best_score)
-            best_score = score, best = static_cast<int>(i);
-    }
-    if (best == -1)
-        print_throw(ARC_FATAL, "atlas is not big enough. please expand it.");
+    std::vector<std::shared_ptr<texture>> texs(images.size());
+    for (size_t i : order)
+        texs[i] = accept(images[i]);
+    return texs;
+}
 
-    quad used = free_rects[best];
-    int dx = used.x;
-    int dy = used.y;
+std::shared_ptr<texture> atlas::P_try_accept(std::shared_ptr<image> image)
+{
+    if (!image || !image->pixels)
+        return nullptr;
+
+    int dx, dy;
+    if (!P_skyline_insert(P_p->skyline, image->width + PADDING, image->height + PADDING, width, height, dx, dy))
+        return nullptr;
 
     imgcpy(image, dx, dy);
+    return output_texture->cut(quad(dx, dy, image->width, image->height));
+}
+
+void atlas::imgcpy(std::shared_ptr<image> image, int dest_x, int dest_y)
+{
+    // suppose channels are the same. (rgba format)
+    size_t row = static_cast<size_t>(image->width) * 4;
+    for (int y = 0; y < image->height; ++y)
+        std::memcpy(pixels + (static_cast<size_t>(dest_y + y) * width + dest_x) * 4,
+                    image->pixels + static_cast<size_t>(y) * row, row);
+}
+
+std::vector<P_skyline_node> atlas::P_get_skyline() const
+{
+    return P_p->skyline;
+}
 
-    quad right = quad(used.x + rw + PADDING, used.y, used.width - rw, rh);
-    quad top = quad(used.x, used.y + rh + PADDING, used.width, used.height - rh);
+void atlas::P_set_skyline(std::vector<P_skyline_node> sky)
+{
+    P_p->skyline = std::move(sky);
+}
 
-    free_rects.erase(free_rects.begin() + best);
+std::shared_ptr<atlas> atlas::make(int w, int h)
+{
+    return std::make_shared<atlas>(w, h);
+}
 
-    if (right.width > 0 && right.height > 0)
-        free_rects.push_back(right);
-    if (top.width > 0 && top.height > 0)
-        free_rects.push_back(top);
+static std::unordered_map<std::string, std::vector<std::shared_ptr<atlas>>> &P_get_shared_pages()
+{
+    static std::unordered_map<std::string, std::vector<std::shared_ptr<atlas>>> pages;
+    return pages;
+}
 
-    for (size_t i = 0; i < free_rects.size(); ++i)
+// the pixels are copied into the page, and go up with the next bind of any texture of it.
+static std::shared_ptr<texture> P_pack_into(std::vector<std::shared_ptr<atlas>> &pages,
+                                            std::shared_ptr<image> image, int page_size)
+{
+    for (auto &page : pages)
     {
-        if (free_rects[i].width == 0 || free_rects[i].height == 0)
-            continue;
-        for (size_t j = i + 1; j < free_rects.size(); ++j)
+        std::shared_ptr<texture> tex = page->P_try_accept(image);
+        if (tex != nullptr)
         {
-            if (free_rects[j].width == 0 || free_rects[j].height == 0)
-                continue;
-
-            quad &a = free_rects[i];
-            quad &b = free_rects[j];
-
-            if (a.x == b.x && a.width == b.width && (a.y + a.height == b.y || b.y + b.height == a.y))
-            {
-                if (a.y < b.y)
-                    a.height += b.height;
-                else
-                    b.height += a.height;
-                (a.y < b.y ? b : a).width = 0;
-            }
-            else if (a.y == b.y && a.height == b.height && (a.x + a.width == b.x || b.x + b.width == a.x))
-            {
-                if (a.x < b.x)
-                    a.width += b.width;
-                else
-                    b.width += a.width;
-                (a.x < b.x ? b : a).height = 0;
-            }
+            page->output_texture->P_mark_dirty(quad(tex->u, tex->v, tex->width, tex->height));
+            return tex;
         }
     }
 
-    free_rects.erase(std::remove_if(free_rects.begin(), free_rects.end(),
-                                    [](const quad &r) { return r.width == 0 || r.height == 0; }),
-                     free_rects.end());
+    std::shared_ptr<atlas> page = atlas::make(page_size, page_size);
+    page->begin();
+    page->end();
+    pages.push_back(page);
+    std::shared_ptr<texture> tex = page->P_try_accept(image);
+    page->output_texture->P_mark_dirty(quad(tex->u, tex->v, tex->width, tex->height));
+    return tex;
+}
 
-    return output_texture->cut(quad(dx, dy, image->width, image->height));
+std::shared_ptr<texture> atlas_pack_shared(const std::string &tag, std::shared_ptr<image> image, int page_size)
+{
+    if (!image || !image->pixels || image->width * 2 > page_size || image->height * 2 > page_size)
+        return nullptr;
+    return P_pack_into(P_get_shared_pages()[tag], image, page_size);
 }
 
-void atlas::imgcpy(std::shared_ptr<image> image, int dest_x, int dest_y)
+bool atlas_update_shared(std::shared_ptr<texture> tex, std::shared_ptr<image> image)
 {
-    // suppose channels are the same. (rgba format)
-    for (int y = 0; y < image->height; ++y)
+    if (tex == nullptr || tex->root == nullptr || !image || !image->pixels)
+        return false;
+
+    for (auto &[tag, pages] : P_get_shared_pages())
     {
-        for (int x = 0; x < image->width; ++x)
+        for (auto &page : pages)
         {
-            int src_index = (y * image->width + x) * 4;
-            int dest_index = ((dest_y + y) * this->width + (dest_x + x)) * 4;
+            if (page->output_texture != tex->root)
+                continue;
+
+            if (image->width == tex->width && image->height == tex->height)
+            {
+                page->imgcpy(image, tex->u, tex->v);
+                page->output_texture->P_mark_dirty(quad(tex->u, tex->v, tex->width, tex->height));
+                return true;
+            }
 
-            for (int c = 0; c < 4; ++c)
-                pixels[dest_index + c] = image->pixels[src_index + c];
+            // the old region is left unused, the page is not repacked.
+            // an image grown too big to share a page gets a page of its own.
+            std::shared_ptr<texture> moved;
+            if (image->width * 2 > page->width || image->height * 2 > page->height)
+            {
+                std::vector<std::shared_ptr<atlas>> own;
+                moved = P_pack_into(own, image, std::max(image->width, image->height));
+            }
+            else
+                moved = P_pack_into(pages, image, page->width - PADDING);
+            tex->u = moved->u;
+            tex->v = moved->v;
+            tex->width = moved->width;
+            tex->height = moved->height;
+            tex->full_width = moved->full_width;
+            tex->full_height = moved->full_height;
+            tex->root = moved->root;
+            tex->P_relying_image = moved->P_relying_image;
+            tex->P_texture_id = moved->P_texture_id;
+            return true;
         }
     }
+    return false;
 }
 
-std::shared_ptr<atlas> atlas::make(int w, int h)
+void atlas_clear_shared()
 {
-    return std::make_shared<atlas>(w, h);
+    P_get_shared_pages().clear();
 }
 
 } // namespace arc::gfx
\ No newline at end of file
@@ -1,10 +1,24 @@
 #pragma once
 #include <core/def.h>
 #include <gfx/image.h>
+#include <string>
+#include <vector>
 
 namespace arc::gfx
 {
 
+// a span of the skyline: the space over [x, x + width) is used up to #y.
+struct P_skyline_node
+{
+    int x;
+    int y;
+    int width;
+};
+
+// bottom-left placement of #w x #h in a #size_w x #size_h area: the lowest position, then the narrowest node,
+// which keeps the skyline flat. returns false if it does not fit.
+bool P_skyline_insert(std::vector<P_skyline_node> &sky, int w, int h, int size_w, int size_h, int &ox, int &oy);
+
 struct atlas
 {
     struct P_impl;
@@ -23,10 +37,28 @@ struct atlas
     void end();
     // add an image to the atlas, and get its texture.
     std::shared_ptr<texture> accept(std::shared_ptr<image> image);
+    // add many images at once, which packs tighter than accepting them one by one in any order.
+    // the textures are in the order of #images.
+    std::vector<std::shared_ptr<texture>> accept_all(const std::vector<std::shared_ptr<image>> &images);
+    // like #accept, but returns nullptr instead of throwing if the image does not fit.
+    std::shared_ptr<texture> P_try_accept(std::shared_ptr<image> image);
     // write an image to the atlas.
     void imgcpy(std::shared_ptr<image> image, int dest_x, int dest_y);
+    // the packing state, so that a filled atlas can be cached and restored later.
+    std::vector<P_skyline_node> P_get_skyline() const;
+    void P_set_skyline(std::vector<P_skyline_node> sky);
 
     static std::shared_ptr<atlas> make(int w, int h);
 };
 
+// pack an image into the shared pages of #tag, adding a page of #page_size when none has room.
+// the page is uploaded once when made, and each packed image as a dirty region on the next bind.
+// returns nullptr if the image is bigger than half of a page on a side. only call it on the main thread.
+std::shared_ptr<texture> atlas_pack_shared(const std::string &tag, std::shared_ptr<image> image, int page_size);
+// replace the pixels of a texture given by #atlas_pack_shared in place, or move it to a new region if the size
+// changed, so that its holders keep drawing the new pixels. returns false if it is not from a shared page.
+bool atlas_update_shared(std::shared_ptr<texture> tex, std::shared_ptr<image> image);
+// forget the shared pages. the textures already handed out keep their pages alive.
+void atlas_clear_shared();
+
 } // namespace arc::gfx
\ No newline at end of file
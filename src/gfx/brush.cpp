@@ -1,12 +1,21 @@
+#include <algorithm>
+#include <cfloat>
 #include <core/log.h>
 #include <core/math.h>
+#include <core/prof.h>
+#include <cstring>
 #include <gfx/brush.h>
 #include <gfx/buffer.h>
 #include <gfx/device.h>
 #include <gfx/image.h>
 #include <gfx/mesh.h>
 #include <gfx/shader.h>
+#include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ARC_BRUSH_SSE2
+#endif
 
 // clang-format off
 #include <gl/glew.h>
@@ -16,30 +25,80 @@
 namespace arc::gfx
 {
 
-static uint16_t P_to_half(float f)
+// the four corners usually share a colour, so it is packed once.
+static void P_pack_corners(const color *cols, vtx_color *out)
+{
+    out[0] = P_pack_color(cols[0]);
+    for (int i = 1; i < 4; i++)
+        out[i] = std::memcmp(&cols[i], &cols[0], sizeof(color)) == 0 ? out[0] : P_pack_color(cols[i]);
+}
+
+static size_t P_stride_of(graph_mode mode)
+{
+    switch (mode)
+    {
+    case graph_mode::TEXTURED_QUAD:
+        return sizeof(vtx_textured);
+    case graph_mode::MULTI_TEXTURED_QUAD:
+        return sizeof(vtx_multi_textured);
+    default:
+        return sizeof(vtx_colored);
+    }
+}
+
+static bool P_is_quad(graph_mode mode)
+{
+    return mode == graph_mode::TEXTURED_QUAD || mode == graph_mode::COLORED_QUAD ||
+           mode == graph_mode::MULTI_TEXTURED_QUAD;
+}
+
+// the corners of the unit quad mapped by #m, in the order the quad vertices are written.
+static void P_bake_quad(const transform &m, float *xs, float *ys)
+{
+#ifdef ARC_BRUSH_SSE2
+    const __m128 cx = _mm_setr_ps(1.0f, 1.0f, 0.0f, 0.0f);
+    const __m128 cy = _mm_setr_ps(1.0f, 0.0f, 0.0f, 1.0f);
+    __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m00), cx), _mm_mul_ps(_mm_set1_ps(m.m01), cy)),
+                          _mm_set1_ps(m.m02));
+    __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.m10), cx), _mm_mul_ps(_mm_set1_ps(m.m11), cy)),
+                          _mm_set1_ps(m.m12));
+    _mm_storeu_ps(xs, x);
+    _mm_storeu_ps(ys, y);
+#else
+    xs[0] = m.m00 + m.m01 + m.m02;
+    ys[0] = m.m10 + m.m11 + m.m12;
+    xs[1] = m.m00 + m.m02;
+    ys[1] = m.m10 + m.m12;
+    xs[2] = m.m02;
+    ys[2] = m.m12;
+    xs[3] = m.m01 + m.m02;
+    ys[3] = m.m11 + m.m12;
+#endif
+}
+
+// the corners of #dst, transformed by #bake unless it is nullptr.
+static void P_quad_corners(const transform *bake, const quad &dst, float *xs, float *ys)
 {
-    union {
-        float f;
-        uint32_t u;
-    } v = {f};
-    uint32_t s = (v.u >> 31) & 0x1;
-    uint32_t e = (v.u >> 23) & 0xFF;
-    uint32_t m = v.u & 0x7FFFFF;
-    if (e == 0xFF)
-        return uint16_t((s << 15) | 0x7C00 | (m ? 1 : 0));
-    if (!e)
-        return uint16_t((s << 15) | (m >> 13));
-    int32_t E = int32_t(e) - 127 + 15;
-    if (E > 31)
-        E = 31;
-    if (E < 0)
-        E = 0;
-    return uint16_t((s << 15) | (E << 10) | (m >> 13));
+    float x = dst.x, y = dst.y, w = dst.width, h = dst.height;
+    if (bake == nullptr)
+    {
+        xs[0] = xs[1] = x + w;
+        xs[2] = xs[3] = x;
+        ys[0] = ys[3] = y + h;
+        ys[1] = ys[2] = y;
+        return;
+    }
+    const transform &t = *bake;
+    P_bake_quad(transform(t.m00 * w, t.m01 * h, t.m00 * x + t.m01 * y + t.m02, t.m10 * w, t.m11 * h,
+                          t.m10 * x + t.m11 * y + t.m12),
+                xs, ys);
 }
 
-void P_w_half(complex_buffer *buf, const color &col)
+static vtx_colored P_colored_at(const transform *bake, vec2 p, const color &col)
 {
-    buf->vtx(P_to_half(col.r)).vtx(P_to_half(col.g)).vtx(P_to_half(col.b)).vtx(P_to_half(col.a));
+    if (bake != nullptr)
+        bake->apply(p);
+    return {static_cast<float>(p.x), static_cast<float>(p.y), P_pack_color(col)};
 }
 
 brush::brush()
@@ -48,6 +107,7 @@ brush::brush()
     ts_push();
     P_default_colored = program::make(builtin_program_type::COLORED);
     P_default_textured = program::make(builtin_program_type::TEXTURED);
+    P_default_multi_textured = program::make(builtin_program_type::MULTI_TEXTURED);
 }
 
 graph_state &brush::current_state()
@@ -135,7 +195,8 @@ void brush::use_program(std::shared_ptr<program> program)
 {
     if (P_state.prog != program)
     {
-        flush();
+        if (!P_queue_live())
+            flush();
         P_state.prog = program;
     }
 }
@@ -152,14 +213,77 @@ void brush::use_state(const graph_state &sts)
 transform brush::get_combined_transform()
 {
     transform cpy = P_camera.combined_out_t;
+    if (P_bake)
+        return cpy;
     return cpy.mul(P_tstack.top());
 }
 
+void brush::bake_transform(bool bake)
+{
+    if (P_bake != bake)
+    {
+        flush();
+        P_bake = bake;
+    }
+}
+
+// every quad is indexed 0 1 3 1 2 3 + 4k, so the quads share one immutable index buffer instead of writing
+// and uploading six indices each. the indices are 16-bit, so a batch over #P_QUAD_CHUNK quads is drawn in chunks,
+// each from its own base vertex.
+constexpr static int P_QUAD_CHUNK = 16384;
+
+static unsigned int P_get_quad_ebo()
+{
+    static unsigned int ebo = 0;
+    if (ebo == 0)
+    {
+        std::vector<uint16_t> idx(P_QUAD_CHUNK * 6);
+        for (int k = 0; k < P_QUAD_CHUNK; k++)
+        {
+            uint16_t v = static_cast<uint16_t>(k * 4);
+            uint16_t *q = idx.data() + k * 6;
+            q[0] = v + 0;
+            q[1] = v + 1;
+            q[2] = v + 3;
+            q[3] = v + 1;
+            q[4] = v + 2;
+            q[5] = v + 3;
+        }
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(uint16_t), idx.data(), GL_STATIC_DRAW);
+    }
+    return ebo;
+}
+
+static void P_draw_quads(complex_buffer *buf, long base, bool custom_idx)
+{
+    if (custom_idx)
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(buf->index_buf.size()), GL_UNSIGNED_INT, 0,
+                                 base);
+        return;
+    }
+    int quads = buf->index_count / 6;
+    for (int first = 0; first < quads; first += P_QUAD_CHUNK)
+    {
+        int n = std::min(quads - first, P_QUAD_CHUNK);
+        glDrawElementsBaseVertex(GL_TRIANGLES, n * 6, GL_UNSIGNED_SHORT, 0, static_cast<GLint>(base + first * 4));
+    }
+}
+
 void brush::flush()
 {
+    ARC_PROF_ZONE("brush::flush");
     auto buf = wbuf;
     auto msh = P_mesh_root;
 
+    if (P_queue_live() && !P_queue.empty())
+    {
+        P_queue_emit();
+        return;
+    }
+
     if (buf->vertex_buf.size() <= 0)
         return;
 
@@ -177,19 +301,31 @@ void brush::flush()
         case graph_mode::TEXTURED_QUAD:
             program_used = P_default_textured;
             break;
+        case graph_mode::MULTI_TEXTURED_QUAD:
+            program_used = P_default_multi_textured;
+            break;
         default:
             program_used = P_default_colored;
             break;
         }
 
+    size_t stride = P_stride_of(P_state.mode);
+    long base = msh->P_stream_write(buf->vertex_buf.data(), buf->vertex_buf.size(), stride);
+
     glBindVertexArray(msh->P_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, msh->P_vbo);
-    if (buf->dirty)
+    if (base >= 0)
+        glBindBuffer(GL_ARRAY_BUFFER, msh->P_ring_vbo);
+    else
     {
-        if (buf->P_vcap_changed)
-            glBufferData(GL_ARRAY_BUFFER, buf->vertex_buf.capacity(), buf->vertex_buf.data(), GL_DYNAMIC_DRAW);
-        else
-            glBufferSubData(GL_ARRAY_BUFFER, 0, buf->vertex_buf.size(), buf->vertex_buf.data());
+        base = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, msh->P_vbo);
+        if (buf->dirty)
+        {
+            if (buf->P_vcap_changed)
+                glBufferData(GL_ARRAY_BUFFER, buf->vertex_buf.capacity(), buf->vertex_buf.data(), GL_DYNAMIC_DRAW);
+            else
+                glBufferSubData(GL_ARRAY_BUFFER, 0, buf->vertex_buf.size(), buf->vertex_buf.data());
+        }
     }
     buf->P_vcap_changed = false;
 
@@ -205,13 +341,21 @@ void brush::flush()
     else
         program_used->cached_uniforms[0].set(get_combined_transform());
 
-    if (P_state.mode == graph_mode::TEXTURED_QUAD || P_state.mode == graph_mode::COLORED_QUAD)
+    // quads use the shared index buffer, unless indices were written with #complex_buffer::idx.
+    bool custom_idx = !buf->index_buf.empty();
+    if (P_is_quad(P_state.mode))
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, msh->P_ebo);
-        if (buf->P_icap_changed)
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, buf->index_buf.capacity() * 4, buf->index_buf.data(), GL_STATIC_DRAW);
+        if (!custom_idx)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, P_get_quad_ebo());
         else
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, buf->index_buf.size() * 4, buf->index_buf.data());
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, msh->P_ebo);
+            if (buf->P_icap_changed)
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, buf->index_buf.capacity() * 4, buf->index_buf.data(),
+                             GL_STATIC_DRAW);
+            else
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, buf->index_buf.size() * 4, buf->index_buf.data());
+        }
     }
     buf->P_icap_changed = false;
     buf->dirty = false;
@@ -220,19 +364,24 @@ void brush::flush()
     {
     case graph_mode::TEXTURED_QUAD:
         P_state.texture->P_bind(1);
-        glDrawElements(GL_TRIANGLES, buf->index_count, GL_UNSIGNED_INT, 0);
+        P_draw_quads(buf, base, custom_idx);
+        break;
+    case graph_mode::MULTI_TEXTURED_QUAD:
+        for (size_t i = 0; i < P_state.textures->slots.size(); i++)
+            P_state.textures->slots[i]->P_bind(1 + static_cast<int>(i));
+        P_draw_quads(buf, base, custom_idx);
         break;
     case graph_mode::COLORED_QUAD:
-        glDrawElements(GL_TRIANGLES, buf->index_count, GL_UNSIGNED_INT, 0);
+        P_draw_quads(buf, base, custom_idx);
         break;
     case graph_mode::COLORED_LINE:
-        glDrawArrays(GL_LINES, 0, buf->vertex_count);
+        glDrawArrays(GL_LINES, base, buf->vertex_count);
         break;
     case graph_mode::COLORED_POINT:
-        glDrawArrays(GL_POINTS, 0, buf->vertex_count);
+        glDrawArrays(GL_POINTS, base, buf->vertex_count);
         break;
     case graph_mode::COLORED_TRIANGLE:
-        glDrawArrays(GL_TRIANGLES, 0, buf->vertex_count);
+        glDrawArrays(GL_TRIANGLES, base, buf->vertex_count);
         break;
     default:
         print_throw(ARC_FATAL, "uknown graphics mode.");
@@ -251,7 +400,8 @@ void brush::assert_mode(graph_mode mode)
 {
     if (P_state.mode != mode)
     {
-        flush();
+        if (!P_queue_live())
+            flush();
         P_state.mode = mode;
     }
 }
@@ -263,23 +413,103 @@ static unsigned int P_get_tex_root(std::shared_ptr<texture> tex)
     return tex->P_texture_id;
 }
 
+static quad P_bound_of(double x1, double y1, double x2, double y2)
+{
+    double x = std::min(x1, x2);
+    double y = std::min(y1, y2);
+    return quad(x, y, std::max(x1, x2) - x, std::max(y1, y2) - y);
+}
+
+static quad P_bound_union(const quad &a, const quad &b)
+{
+    return P_bound_of(std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.prom_x(), b.prom_x()),
+                      std::max(a.prom_y(), b.prom_y()));
+}
+
+// edges that touch count, since lines and points have no area but are still rasterized.
+static bool P_bound_touch(const quad &a, const quad &b)
+{
+    return a.x <= b.prom_x() && b.x <= a.prom_x() && a.y <= b.prom_y() && b.y <= a.prom_y();
+}
+
+static bool P_same_state(const P_brush_cmd &a, const P_brush_cmd &b)
+{
+    if (a.mode != b.mode || a.blend != b.blend || a.prog != b.prog)
+        return false;
+    if (a.mode == graph_mode::MULTI_TEXTURED_QUAD)
+        return a.textures == b.textures;
+    return a.mode != graph_mode::TEXTURED_QUAD || P_get_tex_root(a.tex) == P_get_tex_root(b.tex);
+}
+
 void brush::assert_texture(std::shared_ptr<texture> tex)
 {
     if (P_get_tex_root(P_state.texture) != P_get_tex_root(tex))
     {
-        flush();
+        if (!P_queue_live())
+            flush();
         P_state.texture = tex;
     }
 }
 
+void brush::P_assert_textures(std::shared_ptr<texture_set> set)
+{
+    if (P_state.textures != set)
+    {
+        if (!P_queue_live())
+            flush();
+        P_state.textures = set;
+    }
+}
+
+// a texture already in the set keeps its slot. a full set is replaced rather than cleared,
+// since the recorded draws and meshes may still refer to it.
+int brush::P_multi_slot(std::shared_ptr<texture> tex)
+{
+    unsigned int id = P_get_tex_root(tex);
+    std::shared_ptr<texture_set> set = P_state.textures;
+    if (set != nullptr)
+    {
+        for (size_t i = 0; i < set->slots.size(); i++)
+            if (set->slots[i]->P_texture_id == id)
+                return static_cast<int>(i);
+    }
+
+    if (set == nullptr || static_cast<int>(set->slots.size()) >= P_multi_max)
+    {
+        set = std::make_shared<texture_set>();
+        P_assert_textures(set);
+    }
+    set->slots.push_back(tex);
+    return static_cast<int>(set->slots.size()) - 1;
+}
+
+void brush::use_multi_texture(int n)
+{
+    flush();
+    P_multi_max = std::clamp(n, 0, MULTI_TEXTURE_MAX);
+}
+
+// switch to the mode #tex is drawn in, and return its slot in a multi-textured batch, or -1.
+int brush::P_assert_texture_mode(std::shared_ptr<texture> tex)
+{
+    // the multi-textured batches only work with their own program.
+    if (P_multi_max > 0 && P_state.prog == nullptr)
+    {
+        assert_mode(graph_mode::MULTI_TEXTURED_QUAD);
+        return P_multi_slot(tex);
+    }
+    assert_mode(graph_mode::TEXTURED_QUAD);
+    assert_texture(tex);
+    return -1;
+}
+
 void brush::draw_texture(std::shared_ptr<texture> tex, const quad &dst, const quad &src, long flag)
 {
     if (tex == nullptr)
         return;
     auto buf = wbuf;
 
-    assert_mode(graph_mode::TEXTURED_QUAD);
-    assert_texture(tex);
+    int slot = P_assert_texture_mode(tex);
 
     float u = (src.x + tex->u) / tex->full_width;
     float v = (src.y + tex->v) / tex->full_height;
@@ -295,25 +525,32 @@ void brush::draw_texture(std::shared_ptr<texture> tex, const quad &dst, const qu
 #endif
         std::swap(v, v2);
 
-    float x = dst.x, y = dst.y, w = dst.width, h = dst.height;
-
-    buf->vtx(x + w).vtx(y + h);
-    P_w_half(buf, vertex_color[2]);
-    buf->vtx(u2).vtx(v);
-
-    buf->vtx(x + w).vtx(y);
-    P_w_half(buf, vertex_color[3]);
-    buf->vtx(u2).vtx(v2);
-
-    buf->vtx(x).vtx(y);
-    P_w_half(buf, vertex_color[0]);
-    buf->vtx(u).vtx(v2);
+    float xs[4], ys[4];
+    P_quad_corners(P_bake ? &P_tstack.top() : nullptr, dst, xs, ys);
+    vtx_color c[4];
+    P_pack_corners(vertex_color, c);
 
-    buf->vtx(x).vtx(y + h);
-    P_w_half(buf, vertex_color[1]);
-    buf->vtx(u).vtx(v);
+    if (slot >= 0)
+    {
+        float t = static_cast<float>(slot);
+        vtx_multi_textured *vs = buf->vtx_n<vtx_multi_textured>(4);
+        vs[0] = {xs[0], ys[0], c[2], u2, v, t};
+        vs[1] = {xs[1], ys[1], c[3], u2, v2, t};
+        vs[2] = {xs[2], ys[2], c[0], u, v2, t};
+        vs[3] = {xs[3], ys[3], c[1], u, v, t};
+    }
+    else
+    {
+        vtx_textured *vs = buf->vtx_n<vtx_textured>(4);
+        vs[0] = {xs[0], ys[0], c[2], u2, v};
+        vs[1] = {xs[1], ys[1], c[3], u2, v2};
+        vs[2] = {xs[2], ys[2], c[0], u, v2};
+        vs[3] = {xs[3], ys[3], c[1], u, v};
+    }
 
     buf->end_quad();
+    if (P_queue_on)
+        P_queue_record();
 }
 
 void brush::draw_texture(std::shared_ptr<texture> tex, const quad &dst, long flag)
@@ -322,27 +559,120 @@ void brush::draw_texture(std::shared_ptr<texture> tex, const quad &dst, long fla
         draw_texture(tex, dst, quad(0.0, 0.0, tex->width, tex->height), flag);
 }
 
-void brush::draw_rect(const quad &dst)
+// below this many sprites, setting up an instanced draw costs more than writing their vertices.
+constexpr static int P_SPRITE_INSTANCE_MIN = 64;
+
+void brush::draw_sprites(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n)
 {
-    auto buf = wbuf;
+    if (tex == nullptr || n <= 0)
+        return;
+    // the instanced draw cannot be recorded, nor take a custom program.
+    if (n < P_SPRITE_INSTANCE_MIN || P_queue_live() || P_is_in_mesh || P_state.prog != nullptr)
+        P_bake_sprites(tex, sprites, n);
+    else
+        P_draw_instanced(tex, sprites, n);
+}
 
-    assert_mode(graph_mode::COLORED_QUAD);
+void brush::P_bake_sprites(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n)
+{
+    ARC_PROF_ZONE("brush::bake_sprites");
+    int slot = P_assert_texture_mode(tex);
+    const transform &top = P_tstack.top();
+    float t = static_cast<float>(slot);
+    // the vertices of all the sprites are reserved at once.
+    vtx_multi_textured *ms = slot >= 0 ? wbuf->vtx_n<vtx_multi_textured>(n * 4) : nullptr;
+    vtx_textured *ts = slot >= 0 ? nullptr : wbuf->vtx_n<vtx_textured>(n * 4);
+    float xs[4], ys[4];
+    for (int i = 0; i < n; i++)
+    {
+        const sprite_instance &s = sprites[i];
+        transform m(s.m00, s.m01, s.m02, s.m10, s.m11, s.m12);
+        if (P_bake)
+            m = transform(top).mul(m);
+        P_bake_quad(m, xs, ys);
 
-    float x = dst.x, y = dst.y, w = dst.width, h = dst.height;
+        if (ms != nullptr)
+        {
+            vtx_multi_textured *vs = ms + i * 4;
+            vs[0] = {xs[0], ys[0], s.col, s.u2, s.v, t};
+            vs[1] = {xs[1], ys[1], s.col, s.u2, s.v2, t};
+            vs[2] = {xs[2], ys[2], s.col, s.u, s.v2, t};
+            vs[3] = {xs[3], ys[3], s.col, s.u, s.v, t};
+        }
+        else
+        {
+            vtx_textured *vs = ts + i * 4;
+            vs[0] = {xs[0], ys[0], s.col, s.u2, s.v};
+            vs[1] = {xs[1], ys[1], s.col, s.u2, s.v2};
+            vs[2] = {xs[2], ys[2], s.col, s.u, s.v2};
+            vs[3] = {xs[3], ys[3], s.col, s.u, s.v};
+        }
+    }
+    wbuf->new_vertex(n * 4);
+    wbuf->new_index(n * 6);
+    if (P_queue_on)
+        P_queue_record();
+}
+
+// one static quad, the shared quad indices, drawn once per instance. the corners come from gl_VertexID.
+void brush::P_draw_instanced(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n)
+{
+    ARC_PROF_ZONE("brush::draw_instanced");
+    flush();
+
+    if (P_sprite_vao == 0)
+    {
+        glGenVertexArrays(1, &P_sprite_vao);
+        glGenBuffers(1, &P_sprite_vbo);
+    }
+    size_t size = sizeof(sprite_instance) * n;
+    glBindVertexArray(P_sprite_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, P_sprite_vbo);
+    // the old storage is orphaned, so the upload does not wait for the last frame to be drawn from it.
+    P_sprite_cap = std::max(P_sprite_cap, size);
+    glBufferData(GL_ARRAY_BUFFER, P_sprite_cap, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, sprites);
+
+    std::shared_ptr<program> prog = program::make(builtin_program_type::SPRITE_INSTANCED);
+    glUseProgram(prog->P_program_id);
+    prog->callback_setup(prog);
+    if (P_state.callback_uniform != nullptr)
+        P_state.callback_uniform(prog);
+    // the top transform is applied here even when it is baked, since the instances are not.
+    transform proj = P_camera.combined_out_t;
+    prog->cached_uniforms[0].set(proj.mul(P_tstack.top()));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, P_get_quad_ebo());
+    tex->P_bind(1);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0, n);
+    ARC_PROF_COUNTER("brush::sprite_instances", n);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
 
-    buf->vtx(x + w).vtx(y + h);
-    P_w_half(buf, vertex_color[2]);
+void brush::draw_rect(const quad &dst)
+{
+    auto buf = wbuf;
 
-    buf->vtx(x + w).vtx(y);
-    P_w_half(buf, vertex_color[3]);
+    assert_mode(graph_mode::COLORED_QUAD);
 
-    buf->vtx(x).vtx(y);
-    P_w_half(buf, vertex_color[0]);
+    float xs[4], ys[4];
+    P_quad_corners(P_bake ? &P_tstack.top() : nullptr, dst, xs, ys);
+    vtx_color c[4];
+    P_pack_corners(vertex_color, c);
 
-    buf->vtx(x).vtx(y + h);
-    P_w_half(buf, vertex_color[1]);
+    vtx_colored *vs = buf->vtx_n<vtx_colored>(4);
+    vs[0] = {xs[0], ys[0], c[2]};
+    vs[1] = {xs[1], ys[1], c[3]};
+    vs[2] = {xs[2], ys[2], c[0]};
+    vs[3] = {xs[3], ys[3], c[1]};
 
     buf->end_quad();
+    if (P_queue_on)
+        P_queue_record();
 }
 
 void brush::draw_rect_outline(const quad &dst)
@@ -364,13 +694,14 @@ void brush::draw_triagle(const vec2 &p1, const vec2 &p2, const vec2 &p3)
 
     assert_mode(graph_mode::COLORED_TRIANGLE);
 
-    buf->vtx(static_cast<float>(p1.x)).vtx(static_cast<float>(p1.y));
-    P_w_half(buf, vertex_color[0]);
-    buf->vtx(static_cast<float>(p2.x)).vtx(static_cast<float>(p2.y));
-    P_w_half(buf, vertex_color[1]);
-    buf->vtx(static_cast<float>(p3.x)).vtx(static_cast<float>(p3.y));
-    P_w_half(buf, vertex_color[2]);
+    const transform *bake = P_bake ? &P_tstack.top() : nullptr;
+    vtx_colored *vs = buf->vtx_n<vtx_colored>(3);
+    vs[0] = P_colored_at(bake, p1, vertex_color[0]);
+    vs[1] = P_colored_at(bake, p2, vertex_color[1]);
+    vs[2] = P_colored_at(bake, p3, vertex_color[2]);
     buf->new_vertex(3);
+    if (P_queue_on)
+        P_queue_record();
 }
 
 void brush::draw_line(const vec2 &p1, const vec2 &p2)
@@ -379,11 +710,13 @@ void brush::draw_line(const vec2 &p1, const vec2 &p2)
 
     assert_mode(graph_mode::COLORED_LINE);
 
-    buf->vtx(static_cast<float>(p1.x)).vtx(static_cast<float>(p1.y));
-    P_w_half(buf, vertex_color[0]);
-    buf->vtx(static_cast<float>(p2.x)).vtx(static_cast<float>(p2.y));
-    P_w_half(buf, vertex_color[1]);
+    const transform *bake = P_bake ? &P_tstack.top() : nullptr;
+    vtx_colored *vs = buf->vtx_n<vtx_colored>(2);
+    vs[0] = P_colored_at(bake, p1, vertex_color[0]);
+    vs[1] = P_colored_at(bake, p2, vertex_color[1]);
     buf->new_vertex(2);
+    if (P_queue_on)
+        P_queue_record();
 }
 
 void brush::draw_point(const vec2 &p)
@@ -392,9 +725,11 @@ void brush::draw_point(const vec2 &p)
 
     assert_mode(graph_mode::COLORED_POINT);
 
-    buf->vtx(static_cast<float>(p.x)).vtx(static_cast<float>(p.y));
-    P_w_half(buf, vertex_color[0]);
+    vtx_colored *vs = buf->vtx_n<vtx_colored>(1);
+    vs[0] = P_colored_at(P_bake ? &P_tstack.top() : nullptr, p, vertex_color[0]);
     buf->new_vertex(1);
+    if (P_queue_on)
+        P_queue_record();
 }
 
 void brush::draw_oval(const quad &dst, int segs)
@@ -487,11 +822,241 @@ void brush::scissor_end()
 
 void brush::use_blend(blend_mode mode)
 {
-    flush();
+    // the recorded draws keep their blending, it is applied when they are emitted.
+    if (!P_queue_live())
+        flush();
+    P_blend = mode;
+    if (!P_queue_live())
+        P_apply_blend(mode);
+}
+
+void brush::P_apply_blend(blend_mode mode)
+{
     if (mode == blend_mode::NORMAL)
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     else if (mode == blend_mode::ADDITIVE)
         glBlendFunc(GL_SRC_ALPHA, GL_SRC_ALPHA);
 }
 
+void brush::queue_begin()
+{
+    if (P_is_in_mesh)
+        print_throw(ARC_FATAL, "the deferred mode cannot be used when recording a mesh.");
+    flush();
+    P_queue_on = true;
+    P_queue_layer = 0;
+    P_queue_mark = wbuf->vertex_buf.size();
+}
+
+void brush::queue_end()
+{
+    flush();
+    P_queue_on = false;
+}
+
+void brush::queue_layer(int layer)
+{
+    P_queue_layer = layer;
+}
+
+void brush::queue_sort_layer(int layer, bool sorted)
+{
+    std::erase(P_queue_sorted, layer);
+    if (sorted)
+        P_queue_sorted.push_back(layer);
+}
+
+bool brush::P_queue_live()
+{
+    return P_queue_on && !P_queue_emitting && !P_is_in_mesh;
+}
+
+// the bound is taken from the written vertices, which start with their position, so it is in the space they are drawn
+// in whether or not the transform is baked.
+void brush::P_queue_record()
+{
+    if (!P_queue_live())
+        return;
+
+    size_t end = wbuf->vertex_buf.size();
+    size_t stride = P_stride_of(P_state.mode);
+    int vertices = static_cast<int>((end - P_queue_mark) / stride);
+    if (vertices <= 0)
+        return;
+
+    float x1 = FLT_MAX, y1 = FLT_MAX, x2 = -FLT_MAX, y2 = -FLT_MAX;
+    for (size_t at = P_queue_mark; at < end; at += stride)
+    {
+        float p[2];
+        std::memcpy(p, wbuf->vertex_buf.data() + at, sizeof(p));
+        x1 = std::min(x1, p[0]);
+        y1 = std::min(y1, p[1]);
+        x2 = std::max(x2, p[0]);
+        y2 = std::max(y2, p[1]);
+    }
+    quad bound = P_bound_of(x1, y1, x2, y2);
+
+    // a run of draws in one state, like the glyphs of a text, is kept as one command.
+    if (!P_queue.empty())
+    {
+        P_brush_cmd &last = P_queue.back();
+        if (last.layer == P_queue_layer && last.offset + last.size == P_queue_mark && last.mode == P_state.mode &&
+            last.blend == P_blend && last.prog == P_state.prog && last.textures == P_state.textures &&
+            (last.mode != graph_mode::TEXTURED_QUAD || P_get_tex_root(last.tex) == P_get_tex_root(P_state.texture)))
+        {
+            last.size = end - last.offset;
+            last.vertices += vertices;
+            last.bound = P_bound_union(last.bound, bound);
+            P_queue_mark = end;
+            return;
+        }
+    }
+
+    P_queue.push_back({0, P_queue_layer, P_state.mode, P_blend, P_state.texture, P_state.textures, P_state.prog, bound,
+                       P_queue_mark, end - P_queue_mark, vertices});
+    P_queue_mark = end;
+}
+
+// a stable lsd radix sort of #order by the keys, skipping the bytes that all the keys share.
+static void P_radix_sort(std::vector<uint32_t> &order, std::vector<uint32_t> &tmp, const std::vector<P_brush_cmd> &cmds)
+{
+    tmp.resize(order.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t count[256] = {};
+        for (uint32_t i : order)
+            count[(cmds[i].key >> shift) & 0xFF]++;
+        if (count[(cmds[order[0]].key >> shift) & 0xFF] == order.size())
+            continue;
+        size_t sum = 0;
+        for (size_t &c : count)
+        {
+            size_t n = c;
+            c = sum;
+            sum += n;
+        }
+        for (uint32_t i : order)
+            tmp[count[(cmds[i].key >> shift) & 0xFF]++] = i;
+        order.swap(tmp);
+    }
+}
+
+struct P_brush_batch
+{
+    int layer;
+    // the commands of the batch are chained from #first through #P_queue_emit's next.
+    uint32_t first;
+    uint32_t last;
+    quad bound;
+};
+
+// how many batches a command may be moved back over to join one in its state.
+constexpr static int P_QUEUE_WINDOW = 16;
+constexpr static uint32_t P_QUEUE_END = UINT32_MAX;
+
+void brush::P_queue_emit()
+{
+    ARC_PROF_ZONE("brush::queue");
+    P_queue_emitting = true;
+    graph_state old_state = P_state;
+    blend_mode old_blend = P_blend;
+
+    // the keys order the layers, and within a sorted layer, the states.
+    // the commands of an ordered layer share their key, so the stable sort keeps them in order.
+    for (P_brush_cmd &c : P_queue)
+    {
+        c.key = static_cast<uint64_t>(static_cast<uint16_t>(c.layer + 0x8000)) << 48;
+        if (std::find(P_queue_sorted.begin(), P_queue_sorted.end(), c.layer) == P_queue_sorted.end())
+            continue;
+        uint64_t prog = c.prog == nullptr ? 0 : c.prog->P_program_id & 0x3FF;
+        uint64_t tex = c.mode == graph_mode::TEXTURED_QUAD ? P_get_tex_root(c.tex) : 0;
+        if (c.mode == graph_mode::MULTI_TEXTURED_QUAD)
+            tex = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(c.textures.get()) >> 4);
+        c.key |= static_cast<uint64_t>(c.blend) << 47 | static_cast<uint64_t>(c.mode) << 42 | prog << 32 | tex;
+    }
+
+    std::vector<uint32_t> order(P_queue.size());
+    std::vector<uint32_t> tmp;
+    for (uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    P_radix_sort(order, tmp, P_queue);
+
+    // a command joins the latest batch in its state, unless it would be moved over a draw it overlaps.
+    std::vector<P_brush_batch> batches;
+    std::vector<uint32_t> next(P_queue.size(), P_QUEUE_END);
+    for (uint32_t i : order)
+    {
+        const P_brush_cmd &c = P_queue[i];
+        bool sorted = std::find(P_queue_sorted.begin(), P_queue_sorted.end(), c.layer) != P_queue_sorted.end();
+        int found = -1;
+        int stop = std::max(0, static_cast<int>(batches.size()) - P_QUEUE_WINDOW);
+        for (int b = static_cast<int>(batches.size()) - 1; b >= stop; b--)
+        {
+            const P_brush_batch &bt = batches[b];
+            if (bt.layer != c.layer)
+                break;
+            if (P_same_state(P_queue[bt.first], c))
+            {
+                found = b;
+                break;
+            }
+            if (sorted || P_bound_touch(bt.bound, c.bound))
+                break;
+        }
+
+        if (found < 0)
+        {
+            batches.push_back({c.layer, i, i, c.bound});
+            continue;
+        }
+        P_brush_batch &bt = batches[found];
+        next[bt.last] = i;
+        bt.last = i;
+        bt.bound = P_bound_union(bt.bound, c.bound);
+    }
+
+    // the recorded vertices are copied back batch by batch.
+    std::swap(P_queue_bytes, wbuf->vertex_buf);
+    wbuf->clear();
+    wbuf->P_vcap_changed = true;
+
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const P_brush_cmd &head = P_queue[batches[b].first];
+        assert_mode(head.mode);
+        if (head.mode == graph_mode::TEXTURED_QUAD)
+            assert_texture(head.tex);
+        if (head.mode == graph_mode::MULTI_TEXTURED_QUAD)
+            P_assert_textures(head.textures);
+        use_program(head.prog);
+        if (b == 0 || head.blend != P_blend)
+        {
+            flush();
+            P_blend = head.blend;
+            P_apply_blend(head.blend);
+        }
+
+        for (uint32_t i = batches[b].first; i != P_QUEUE_END; i = next[i])
+        {
+            const P_brush_cmd &c = P_queue[i];
+            std::memcpy(wbuf->vtx_n<uint8_t>(static_cast<int>(c.size)), P_queue_bytes.data() + c.offset, c.size);
+            wbuf->new_vertex(c.vertices);
+            if (P_is_quad(c.mode))
+                wbuf->new_index(c.vertices / 4 * 6);
+        }
+    }
+    ARC_PROF_COUNTER("brush::queue_commands", P_queue.size());
+    ARC_PROF_COUNTER("brush::queue_batches", batches.size());
+    flush();
+
+    P_state = old_state;
+    if (P_blend != old_blend)
+        P_apply_blend(old_blend);
+    P_blend = old_blend;
+    P_queue.clear();
+    P_queue_bytes.clear();
+    P_queue_mark = 0;
+    P_queue_emitting = false;
+}
+
 } // namespace arc::gfx
\ No newline at end of file
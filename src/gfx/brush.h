@@ -9,10 +9,29 @@
 #include <gfx/shader.h>
 #include <core/math.h>
 #include <gfx/mesh.h>
+#include <vector>
 
 namespace arc::gfx
 {
 
+// a primitive recorded by the deferred mode, its vertices stay in the buffer until the queue is flushed.
+struct P_brush_cmd
+{
+    uint64_t key;
+    int layer;
+    graph_mode mode;
+    blend_mode blend;
+    std::shared_ptr<texture> tex;
+    std::shared_ptr<texture_set> textures;
+    std::shared_ptr<program> prog;
+    // in the space of the vertices, used to tell whether two draws may be reordered.
+    quad bound;
+    // bytes in #brush::wbuf.
+    size_t offset;
+    size_t size;
+    int vertices;
+};
+
 struct brush
 {
     color vertex_color[4]{};
@@ -21,11 +40,27 @@ struct brush
     graph_state P_state;
     std::shared_ptr<program> P_default_colored;
     std::shared_ptr<program> P_default_textured;
+    std::shared_ptr<program> P_default_multi_textured;
     complex_buffer *wbuf;
     mesh *P_mesh_root;
     bool P_is_in_mesh = false;
     // when true, the brush will clear the buffer when flushed.
     bool P_clear_when_flush = true;
+    // the textures a multi-textured batch may bind, 0 when off. see #use_multi_texture.
+    int P_multi_max = 0;
+    blend_mode P_blend = blend_mode::NORMAL;
+    // when true, the top transform is applied to the vertices as they are written. see #bake_transform.
+    bool P_bake = false;
+    /* unstable */ unsigned int P_sprite_vao = 0;
+    /* unstable */ unsigned int P_sprite_vbo = 0;
+    /* unstable */ size_t P_sprite_cap = 0;
+    /* unstable */ bool P_queue_on = false;
+    /* unstable */ bool P_queue_emitting = false;
+    /* unstable */ int P_queue_layer = 0;
+    /* unstable */ size_t P_queue_mark = 0;
+    /* unstable */ std::vector<P_brush_cmd> P_queue;
+    /* unstable */ std::vector<int> P_queue_sorted;
+    /* unstable */ std::vector<uint8_t> P_queue_bytes;
 
     brush();
 
@@ -42,6 +77,7 @@ struct brush
     void ts_shr(const vec2 &v);
     void ts_rot(double r);
     void ts_rot(const vec2 &v, double r);
+    // the transform the batched vertices are drawn with, which leaves out the top transform when it is baked.
     transform get_combined_transform();
 
     void flush();
@@ -54,6 +90,10 @@ struct brush
     void draw_texture(std::shared_ptr<texture> tex, const quad &dst, const quad &src,
                       long flag = brush_flag::NO);
     void draw_texture(std::shared_ptr<texture> tex, const quad &dst, long flag = brush_flag::NO);
+    // draw #n sprites of #tex, each with its own transform and colour, under the top transform.
+    // they are drawn in one instanced draw, or written as quads when there are few of them, when the deferred
+    // mode is on, in a mesh, or with a custom program.
+    void draw_sprites(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n);
     void draw_rect(const quad &dst);
     void draw_rect_outline(const quad &dst);
     void draw_triagle(const vec2 &p1, const vec2 &p2, const vec2 &p3);
@@ -67,6 +107,36 @@ struct brush
     void scissor(const quad &quad);
     void scissor_end();
     void use_blend(blend_mode mode);
+    // draw textures with the default program through batches that bind up to #n textures at once, at most
+    // #MULTI_TEXTURE_MAX, so that sprites from different textures or atlas pages share a draw. 0 turns it off.
+    // each vertex carries the index of its texture, see #vtx_multi_textured.
+    // draws with a custom program keep binding a single texture.
+    void use_multi_texture(int n);
+    // apply the top transform to the vertices when they are written instead of when they are drawn, so that draws
+    // under different transforms, like rotated particles, share a batch. it is off by default.
+    void bake_transform(bool bake);
+
+    // the deferred mode. draws are recorded with their state instead of flushing whenever the texture, the mode,
+    // the program or the blending changes, and the next flush sorts them by layer and merges them into as few draws
+    // as it can. a draw only moves ahead of draws it does not overlap, so the picture is the same as drawn in order.
+    // the transform at the flush applies to every recorded draw, as it does to an ordinary batch.
+    void queue_begin();
+    void queue_end();
+    // draws go to #layer from now on, lower layers are drawn first.
+    void queue_layer(int layer);
+    // the draws of a sorted layer are grouped by state regardless of overlap.
+    // it is meant for layers whose order does not matter, for example opaque tiles or additive particles.
+    void queue_sort_layer(int layer, bool sorted = true);
+
+    bool P_queue_live();
+    void P_queue_record();
+    void P_queue_emit();
+    void P_apply_blend(blend_mode mode);
+    int P_multi_slot(std::shared_ptr<texture> tex);
+    void P_assert_textures(std::shared_ptr<texture_set> set);
+    int P_assert_texture_mode(std::shared_ptr<texture> tex);
+    void P_bake_sprites(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n);
+    void P_draw_instanced(std::shared_ptr<texture> tex, const sprite_instance *sprites, int n);
 };
 
 } // namespace arc::gfx
\ No newline at end of file
@@ -1,30 +1,71 @@
 #include <gfx/brush.h>
 #include <gfx/buffer.h>
+#include <gfx/image.h>
 
 namespace arc::gfx
 {
 
+#ifndef ARC_VERTEX_RGBA8
+static uint16_t P_to_half(float f)
+{
+    union {
+        float f;
+        uint32_t u;
+    } v = {f};
+    uint32_t s = (v.u >> 31) & 0x1;
+    uint32_t e = (v.u >> 23) & 0xFF;
+    uint32_t m = v.u & 0x7FFFFF;
+    if (e == 0xFF)
+        return uint16_t((s << 15) | 0x7C00 | (m ? 1 : 0));
+    if (!e)
+        return uint16_t((s << 15) | (m >> 13));
+    int32_t E = int32_t(e) - 127 + 15;
+    if (E > 31)
+        E = 31;
+    if (E < 0)
+        E = 0;
+    return uint16_t((s << 15) | (E << 10) | (m >> 13));
+}
+#endif
+
+vtx_color P_pack_color(const color &col)
+{
+#ifdef ARC_VERTEX_RGBA8
+    auto byte = [](double v) { return static_cast<uint8_t>(std::clamp(v, 0.0, 1.0) * 255.0 + 0.5); };
+    return {byte(col.r), byte(col.g), byte(col.b), byte(col.a)};
+#else
+    return {P_to_half(col.r), P_to_half(col.g), P_to_half(col.b), P_to_half(col.a)};
+#endif
+}
+
+sprite_instance sprite_instance::make(const texture &tex, const quad &dst, const transform &t, const color &col)
+{
+    // the rows of t * [w 0 x; 0 h y].
+    float x = dst.x, y = dst.y, w = dst.width, h = dst.height;
+    sprite_instance s;
+    s.m00 = t.m00 * w;
+    s.m01 = t.m01 * h;
+    s.m02 = t.m00 * x + t.m01 * y + t.m02;
+    s.m10 = t.m10 * w;
+    s.m11 = t.m11 * h;
+    s.m12 = t.m10 * x + t.m11 * y + t.m12;
+
+    s.u = static_cast<float>(tex.u) / tex.full_width;
+    s.v = static_cast<float>(tex.v) / tex.full_height;
+    s.u2 = static_cast<float>(tex.u + tex.width) / tex.full_width;
+    s.v2 = static_cast<float>(tex.v + tex.height) / tex.full_height;
+#ifdef ARC_Y_IS_DOWN
+    std::swap(s.v, s.v2);
+#endif
+    s.col = P_pack_color(col);
+    return s;
+}
+
 void complex_buffer::end_quad()
 {
+    // the indices are implied, see #P_get_quad_ebo in brush.cpp.
     new_index(6);
     new_vertex(4);
-
-    std::size_t s = sizeof(unsigned int) * 6;
-    std::size_t old = index_buf.size();
-    if (old + s > index_buf.capacity())
-    {
-        index_buf.reserve(index_buf.capacity() * 2);
-        P_icap_changed = true;
-    }
-
-    unsigned int k = vertex_count - 4;
-    // we don't use #idx to cut down 5 another cap checks.
-    index_buf.push_back(0 + k);
-    index_buf.push_back(1 + k);
-    index_buf.push_back(3 + k);
-    index_buf.push_back(1 + k);
-    index_buf.push_back(2 + k);
-    index_buf.push_back(3 + k);
 }
 
 void complex_buffer::new_vertex(int count)
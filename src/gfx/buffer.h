@@ -1,15 +1,74 @@
 #pragma once
+#include <algorithm>
 #include <core/def.h>
+#include <core/math.h>
+#include <cstdint>
 #include <cstring>
+#include <gfx/color.h>
 #include <vector>
 
 namespace arc::gfx
 {
 
 struct brush;
+struct texture;
+
+// the colour of a vertex: half floats, or with ARC_VERTEX_RGBA8 defined (cmake -DARC_VERTEX_RGBA8=ON),
+// normalized bytes, which makes the vertices a third smaller, but clamps the channels to [0, 1].
+// custom programs should lay out the attributes with #vtx_colored and #vtx_textured.
+#ifdef ARC_VERTEX_RGBA8
+struct vtx_color
+{
+    uint8_t r, g, b, a;
+};
+#else
+struct vtx_color
+{
+    uint16_t r, g, b, a;
+};
+#endif
+
+struct vtx_colored
+{
+    float x, y;
+    vtx_color col;
+};
+
+struct vtx_textured
+{
+    float x, y;
+    vtx_color col;
+    float u, v;
+};
+
+// the vertex of a multi-textured batch, #tex is the index of its texture in the bound #texture_set.
+struct vtx_multi_textured
+{
+    float x, y;
+    vtx_color col;
+    float u, v;
+    float tex;
+};
+
+vtx_color P_pack_color(const color &col);
+
+// an instance of #brush::draw_sprites: the unit quad is mapped by the affine rows and sampled over [u, u2] x [v, v2].
+struct sprite_instance
+{
+    float m00, m01, m02;
+    float m10, m11, m12;
+    float u, v, u2, v2;
+    vtx_color col;
+
+    // the whole of #tex drawn over #dst, then transformed by #t, as #brush::draw_texture would draw it.
+    static sprite_instance make(const texture &tex, const quad &dst, const transform &t = transform(),
+                                const color &col = color());
+};
 
 // currently it only supports quad-drawing indexing.
 // maybe in the future I'll extend it.
+// quads only count their indices, which are shared by all buffers. #index_buf is only for indices written
+// with #idx, which then replace the shared ones.
 struct complex_buffer
 {
     std::vector<uint8_t> vertex_buf;
@@ -38,6 +97,24 @@ struct complex_buffer
         return *this;
     }
 
+    // reserve #n vertices at the end to be filled in place, with a single growth check.
+    // the pointer is invalidated by the next write.
+    template <typename V> V *vtx_n(int n)
+    {
+        size_t s = sizeof(V) * n;
+        size_t old = vertex_buf.size();
+        if (old + s > vertex_buf.capacity())
+        {
+            vertex_buf.reserve(std::max(vertex_buf.capacity() * 2, old + s));
+            P_vcap_changed = true;
+        }
+
+        vertex_buf.resize(old + s);
+        dirty = true;
+
+        return reinterpret_cast<V *>(vertex_buf.data() + old);
+    }
+
     // write an index.
     inline complex_buffer &idx(unsigned int t)
     {
@@ -1,4 +1,5 @@
 #include <core/log.h>
+#include <core/prof.h>
 #include <core/time.h>
 #include <gfx/brush.h>
 #include <gfx/device.h>
@@ -270,6 +271,7 @@ void tk_lifecycle(int fps, int tps, bool vsync)
 
             while (logic_debt >= DT_LOGIC_NS && max_catch--)
             {
+                ARC_PROF_ZONE("tick");
                 P_cur_in_tick = true;
                 for (auto &e : event_tick)
                     e();
@@ -283,6 +285,7 @@ void tk_lifecycle(int fps, int tps, bool vsync)
 
             if (fps <= 0 || current - last_render >= DT_RENDER_NS)
             {
+                ARC_PROF_ZONE("render");
                 clock::now().partial = std::clamp(1.0 - (logic_debt / DT_LOGIC_NS), 0.0, 1.0);
 
                 auto brush = direct_mesh->P_brush;
@@ -290,6 +293,7 @@ void tk_lifecycle(int fps, int tps, bool vsync)
                     e(brush);
                 clock::now().render_ticks++;
                 brush->flush();
+                direct_mesh->P_stream_next();
                 tk_swap_buffers();
 
                 render_frm++;
@@ -302,6 +306,8 @@ void tk_lifecycle(int fps, int tps, bool vsync)
             {
                 rtps = tick_frm * 2;
                 rfps = render_frm * 2;
+                ARC_PROF_COUNTER("tps", rtps);
+                ARC_PROF_COUNTER("fps", rfps);
                 tick_frm = render_frm = 0;
                 last_stat = current;
             }
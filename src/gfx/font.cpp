@@ -1,23 +1,115 @@
+#include <core/cache.h>
 #include <core/chcvt.h>
 #include <core/io.h>
 #include <core/log.h>
+#include <core/time.h>
 #include <gfx/atlas.h>
 #include <gfx/brush.h>
 #include <gfx/font.h>
 #include <gfx/image.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fmt/format.h>
+#include <iterator>
+#include <mutex>
+#include <thread>
 
 #include <freetype2/ft2build.h>
 #include FT_FREETYPE_H
 
+// the sdf renderer came with freetype 2.11.
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define P_FT_HAS_SDF
+#endif
+
 namespace arc::gfx
 {
 
+// bump it when the glyph rasterization or the cache layout changes.
+constexpr static uint32_t P_FONT_CACHE_VERSION = 2;
+// the gap around each glyph on a page, so that linear filtering does not bleed the neighbours in.
+constexpr static int P_GLYPH_PADDING = 1;
+
+struct P_glyph_page
+{
+    std::shared_ptr<image> img;
+    std::shared_ptr<texture> tex;
+    std::vector<P_skyline_node> skyline;
+    // the glyphs on the page, forgotten when it is evicted.
+    std::vector<char32_t> glyphs;
+    // the render tick it was last drawn at.
+    long last_use = -1;
+};
+
+// a glyph quad of a cached layout, relative to the drawing position.
+struct P_layout_quad
+{
+    std::shared_ptr<texture> tex;
+    quad dst;
+};
+
+struct P_layout
+{
+    // the bytes of the string, to tell apart the hash collisions.
+    std::string text;
+    bool wide;
+    long align;
+    double max_w;
+    double scale;
+    std::vector<P_layout_quad> quads;
+    // the pages the quads are on, to keep them from eviction while drawn.
+    std::vector<int> pages;
+    // the bound at the origin, already aligned.
+    font_render_bound bound;
+    // the page evictions when it was made. if any page was evicted since, the quads may point at other glyphs.
+    uint64_t epoch;
+    long last_use;
+};
+
+// a rasterized glyph, before it is placed on a page. the pre-warm worker makes them too.
+struct P_raster
+{
+    char32_t ch = 0;
+    int width = 0;
+    int height = 0;
+    // a byte per pixel, the coverage, or the distance to the outline in sdf mode.
+    std::vector<uint8_t> alpha;
+    vec2 size;
+    double advance = 0;
+    vec2 offset;
+};
+
+// the layouts kept at most. when it is full, the layouts not drawn in this frame are dropped.
+constexpr static size_t P_LAYOUT_CACHE_MAX = 1024;
+
 struct font::P_impl
 {
     FT_FaceRec_ *face_ptr;
     FT_LibraryRec_ *lib_ptr;
-    std::unordered_map<int, std::shared_ptr<atlas>> codemap;
+    std::vector<P_glyph_page> pages;
     double res, pix;
+    // freetype reads the face from memory, so the file should be kept alive.
+    std::vector<uint8_t> file;
+    uint64_t file_hash = 0;
+    std::string cache_name;
+    // true if glyphs were rasterized since the cache was loaded.
+    bool dirty = false;
+    bool warned_full = false;
+    // increased on each page eviction.
+    uint64_t epoch = 0;
+    std::unordered_map<uint64_t, P_layout> layouts;
+
+    // the pre-warm worker. it opens its own face, since a face cannot be used by two threads.
+    std::thread worker;
+    std::mutex worker_mutex;
+    std::condition_variable worker_cv;
+    std::deque<char32_t> queued;
+    std::vector<P_raster> ready;
+    std::atomic<bool> has_ready = false;
+    bool stop = false;
 };
 
 font::font() : P_pimpl(std::make_unique<P_impl>())
@@ -26,75 +118,514 @@ font::font() : P_pimpl(std::make_unique<P_impl>())
 
 font::~font()
 {
+    {
+        std::lock_guard<std::mutex> lock(P_pimpl->worker_mutex);
+        P_pimpl->stop = true;
+    }
+    P_pimpl->worker_cv.notify_all();
+    if (P_pimpl->worker.joinable())
+        P_pimpl->worker.join();
+
+    if (P_pimpl->dirty)
+    {
+        try
+        {
+            save_cache();
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
     FT_Done_Face(P_pimpl->face_ptr);
     FT_Done_FreeType(P_pimpl->lib_ptr);
 }
 
-std::shared_ptr<texture> P_flush_codemap(font::P_impl *P_p, char32_t ch, std::shared_ptr<image> img)
+static int P_page_size(font::P_impl *P_p)
 {
-    int code = static_cast<int>(std::floor(static_cast<int>(ch) / 256.0));
-    if (P_p->codemap.find(code) == P_p->codemap.end())
+    return static_cast<int>(P_p->res * 16);
+}
+
+// #pixels is owned by the page, and uploaded whole once. later glyphs only upload their own regions.
+static P_glyph_page P_make_page(int size, uint8_t *pixels)
+{
+    P_glyph_page page;
+    page.img = image::make(size, size, pixels);
+    page.tex = texture::make(page.img);
+    page.tex->parameters(texture_parameters(texture_parameter::UV_CLAMP, texture_parameter::FILTER_LINEAR,
+                                            texture_parameter::FILTER_LINEAR));
+    page.skyline.push_back({0, 0, size});
+    return page;
+}
+
+static void P_forget_glyph(font &fnt, char32_t ch)
+{
+    if (ch < 0x10000)
     {
-        int ats = P_p->res * 16;
-        P_p->codemap[code] = atlas::make(ats, ats);
-        P_p->codemap[code]->begin();
+        if (fnt.P_bmp[ch >> 8] != nullptr)
+            fnt.P_bmp[ch >> 8][ch & 0xff] = glyph();
     }
+    else
+        fnt.glyph_map.erase(ch);
+}
 
-    auto atl = P_p->codemap[code];
-    auto tptr = atl->accept(img);
-    atl->end();
-    return tptr;
+static void P_evict_page(font &fnt, P_glyph_page &page, int size)
+{
+    for (char32_t ch : page.glyphs)
+        P_forget_glyph(fnt, ch);
+    fnt.P_pimpl->epoch++;
+    page.glyphs.clear();
+    page.skyline.assign(1, {0, 0, size});
+    // the padding must be blank again.
+    std::memset(page.img->pixels, 0, static_cast<size_t>(size) * size * 4);
+    page.tex->P_mark_dirty(quad(0, 0, size, size));
 }
 
-glyph font::make_glyph(char32_t ch)
+constexpr static size_t P_NO_PAGE = SIZE_MAX;
+
+// find room for #w x #h, and return the page. if every page is full, a new page is made up to #max_pages,
+// then the least recently drawn page is evicted. pages drawn in this frame are never evicted,
+// since the brush may not have flushed their quads yet.
+// a glyph that is not made #on_demand, that is, a pre-warmed one, only takes free room: it never evicts, never goes
+// over #max_pages and does not count as drawn. #P_NO_PAGE if there is no free room for it.
+static size_t P_alloc_glyph(font &fnt, font::P_impl *P_p, int w, int h, int &ox, int &oy, bool on_demand = true)
+{
+    int size = P_page_size(P_p);
+    int pw = w + P_GLYPH_PADDING;
+    int ph = h + P_GLYPH_PADDING;
+    if (pw > size || ph > size)
+        print_throw(ARC_FATAL, "glyph of {}x{} does not fit a page of {}.", w, h, size);
+
+    std::vector<P_glyph_page> &pages = P_p->pages;
+    long frame = clock::now().render_ticks;
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        if (P_skyline_insert(pages[i].skyline, pw, ph, size, size, ox, oy))
+        {
+            if (on_demand)
+                pages[i].last_use = frame;
+            return i;
+        }
+    }
+
+    size_t victim = pages.size();
+    if (pages.size() >= fnt.max_pages)
+    {
+        if (!on_demand)
+            return P_NO_PAGE;
+        for (size_t i = 0; i < pages.size(); i++)
+            if (pages[i].last_use < frame && (victim == pages.size() || pages[i].last_use < pages[victim].last_use))
+                victim = i;
+        if (victim == pages.size() && !P_p->warned_full)
+        {
+            print(ARC_WARN, "all {} glyph pages are drawn in one frame, going over the limit.", pages.size());
+            P_p->warned_full = true;
+        }
+    }
+
+    if (victim == pages.size())
+        pages.push_back(P_make_page(size, new uint8_t[static_cast<size_t>(size) * size * 4]()));
+    else
+        P_evict_page(fnt, pages[victim], size);
+
+    P_skyline_insert(pages[victim].skyline, pw, ph, size, size, ox, oy);
+    // a new page of pre-warmed glyphs is not pinned, but is still evicted after the pages not drawn lately.
+    pages[victim].last_use = on_demand ? frame : frame - 1;
+    return victim;
+}
+
+static const glyph *P_find_glyph(const font &fnt, char32_t ch)
+{
+    if (ch < 0x10000)
+    {
+        const std::unique_ptr<glyph[]> &blk = fnt.P_bmp[ch >> 8];
+        return blk != nullptr && blk[ch & 0xff].texpart != nullptr ? &blk[ch & 0xff] : nullptr;
+    }
+    auto it = fnt.glyph_map.find(ch);
+    return it == fnt.glyph_map.end() ? nullptr : &it->second;
+}
+
+static void P_store_glyph(font &fnt, char32_t ch, const glyph &g)
+{
+    if (ch < 0x10000)
+    {
+        std::unique_ptr<glyph[]> &blk = fnt.P_bmp[ch >> 8];
+        if (blk == nullptr)
+            blk = std::make_unique<glyph[]>(256);
+        blk[ch & 0xff] = g;
+    }
+    else
+        fnt.glyph_map[ch] = g;
+}
+
+// it only touches #face, so the pre-warm worker can call it with its own.
+static void P_rasterize(FT_FaceRec_ *face, char32_t ch, double res, double pix, double height, font_mode mode,
+                        P_raster &out)
 {
-    auto face = P_pimpl->face_ptr;
     unsigned int idx = FT_Get_Char_Index(face, ch);
 
-    FT_Set_Pixel_Sizes(face, 0, P_pimpl->res);
+    FT_Set_Pixel_Sizes(face, 0, res);
     FT_Load_Glyph(face, idx, FT_LOAD_DEFAULT);
+#ifdef P_FT_HAS_SDF
+    FT_Render_Glyph(face->glyph, mode == font_mode::SDF ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL);
+#else
     FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
-    FT_Bitmap_ m0 = face->glyph->bitmap;
-
-    int len = static_cast<int>(m0.width * m0.rows * 4);
-    uint8_t *buf = new uint8_t[len];
-    for (int i = 0; i < len; i += 4)
+#endif
+    const FT_Bitmap_ &m0 = face->glyph->bitmap;
+
+    out.ch = ch;
+    out.width = static_cast<int>(m0.width);
+    out.height = static_cast<int>(m0.rows);
+    out.alpha.resize(static_cast<size_t>(out.width) * out.height);
+    for (int y = 0; y < out.height; y++)
+        std::memcpy(out.alpha.data() + static_cast<size_t>(y) * out.width,
+                    m0.buffer + static_cast<ptrdiff_t>(y) * m0.pitch, out.width);
+
+    double ds = res / pix;
+    const auto &mt = face->glyph->metrics;
+    out.advance = face->glyph->advance.x / ds / 64.0;
+    if (mode == font_mode::SDF)
     {
-        uint8_t grey = m0.buffer[i / 4];
-        buf[i + 0] = 255;
-        buf[i + 1] = 255;
-        buf[i + 2] = 255;
-        buf[i + 3] = grey;
+        // the field spreads out of the outline, so the quad covers the whole bitmap instead of the ink.
+        out.size.x = ch == ' ' ? mt.horiAdvance / ds / 64.0 : out.width / ds;
+        out.size.y = out.height / ds;
+        out.offset.x = face->glyph->bitmap_left / ds;
+#ifdef ARC_Y_IS_DOWN
+        out.offset.y = -face->glyph->bitmap_top / ds + height + face->bbox.yMin / ds / 64.0;
+#else
+        out.offset.y = face->glyph->bitmap_top / ds - out.size.y;
+#endif
+        return;
     }
 
-    std::shared_ptr<image> img =
-        image::make(static_cast<int>(face->glyph->bitmap.width), static_cast<int>(face->glyph->bitmap.rows), buf);
+    out.size.x = ch == ' ' ? mt.horiAdvance / ds / 64.0 : mt.width / ds / 64.0;
+    out.size.y = mt.height / ds / 64.0;
+    out.offset.x = mt.horiBearingX / ds / 64.0;
+#ifdef ARC_Y_IS_DOWN
+    out.offset.y = -mt.horiBearingY / ds / 64.0 + height + face->bbox.yMin / ds / 64.0;
+#else
+    out.offset.y = mt.horiBearingY / ds / 64.0 - out.size.y;
+#endif
+}
 
-    double ds = P_pimpl->res / P_pimpl->pix;
+// write the glyph right into a page, only its region is uploaded. false if it is not made #on_demand
+// and there is no free room, see #P_alloc_glyph.
+static bool P_place_glyph(font &fnt, const P_raster &r, glyph &g, bool on_demand = true)
+{
+    font::P_impl *P_p = fnt.P_pimpl.get();
+    int ox, oy;
+    size_t pi = P_alloc_glyph(fnt, P_p, r.width, r.height, ox, oy, on_demand);
+    if (pi == P_NO_PAGE)
+        return false;
+    P_glyph_page &page = P_p->pages[pi];
+    int size = page.img->width;
+    for (int y = 0; y < r.height; y++)
+    {
+        uint8_t *dst = page.img->pixels + (static_cast<size_t>(oy + y) * size + ox) * 4;
+        const uint8_t *src = r.alpha.data() + static_cast<size_t>(y) * r.width;
+        for (int x = 0; x < r.width; x++)
+        {
+            dst[x * 4 + 0] = 255;
+            dst[x * 4 + 1] = 255;
+            dst[x * 4 + 2] = 255;
+            dst[x * 4 + 3] = src[x];
+        }
+    }
+    page.tex->P_mark_dirty(quad(ox, oy, r.width, r.height));
+    page.glyphs.push_back(r.ch);
+    P_p->dirty = true;
+
+    g.texpart = page.tex->cut(quad(ox, oy, r.width, r.height));
+    g.P_page = static_cast<int>(pi);
+    g.size = r.size;
+    g.advance = r.advance;
+    g.offset = r.offset;
+    return true;
+}
 
+glyph font::make_glyph(char32_t ch)
+{
+    P_raster r;
+    P_rasterize(P_pimpl->face_ptr, ch, P_pimpl->res, P_pimpl->pix, height, mode, r);
     glyph g;
-    g.texpart = P_flush_codemap(P_pimpl.get(), ch, img);
-    g.texpart->parameters(texture_parameters(texture_parameter::UV_CLAMP, texture_parameter::FILTER_LINEAR,
-                                             texture_parameter::FILTER_LINEAR));
-    g.size.x = ch == ' ' ? face->glyph->metrics.horiAdvance / ds / 64.0 : face->glyph->metrics.width / ds / 64.0;
-    g.size.y = face->glyph->metrics.height / ds / 64.0;
-    g.advance = face->glyph->advance.x / ds / 64.0;
-    g.offset.x = face->glyph->metrics.horiBearingX / ds / 64.0;
+    P_place_glyph(*this, r, g);
+    return g;
+}
+
+static void P_prewarm_run(font::P_impl *P_p, double height, font_mode mode)
+{
+    FT_LibraryRec_ *lib;
+    FT_FaceRec_ *face;
+    FT_Init_FreeType(&lib);
+    FT_New_Memory_Face(lib, P_p->file.data(), static_cast<FT_Long>(P_p->file.size()), 0, &face);
+    FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+
+    while (true)
+    {
+        char32_t ch;
+        {
+            std::unique_lock<std::mutex> lock(P_p->worker_mutex);
+            P_p->worker_cv.wait(lock, [P_p]() { return P_p->stop || !P_p->queued.empty(); });
+            if (P_p->stop)
+                break;
+            ch = P_p->queued.front();
+            P_p->queued.pop_front();
+        }
+
+        P_raster r;
+        P_rasterize(face, ch, P_p->res, P_p->pix, height, mode, r);
+
+        std::lock_guard<std::mutex> lock(P_p->worker_mutex);
+        P_p->ready.push_back(std::move(r));
+        P_p->has_ready.store(true, std::memory_order_release);
+    }
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(lib);
+}
+
+// how many pre-warmed glyphs are placed per drawing, so that a large range is spread over frames.
+constexpr static size_t P_PREWARM_PER_FRAME = 64;
+
+// place what the worker has rasterized so far. pages are only written on the render thread.
+// the glyphs only take free room. once the pages are full, the rest of the pre-warm is dropped,
+// and those glyphs are made on demand as before.
+static void P_adopt_prewarmed(font &fnt)
+{
+    font::P_impl *P_p = fnt.P_pimpl.get();
+    if (!P_p->has_ready.load(std::memory_order_acquire))
+        return;
+
+    std::vector<P_raster> ready;
+    {
+        std::lock_guard<std::mutex> lock(P_p->worker_mutex);
+        size_t n = std::min(P_p->ready.size(), P_PREWARM_PER_FRAME);
+        ready.assign(std::make_move_iterator(P_p->ready.begin()), std::make_move_iterator(P_p->ready.begin() + n));
+        P_p->ready.erase(P_p->ready.begin(), P_p->ready.begin() + n);
+        P_p->has_ready.store(!P_p->ready.empty(), std::memory_order_relaxed);
+    }
+
+    for (const P_raster &r : ready)
+    {
+        // some may have been made on demand meanwhile.
+        if (P_find_glyph(fnt, r.ch) != nullptr)
+            continue;
+        glyph g;
+        if (!P_place_glyph(fnt, r, g, false))
+        {
+            std::lock_guard<std::mutex> lock(P_p->worker_mutex);
+            P_p->queued.clear();
+            P_p->ready.clear();
+            P_p->has_ready.store(false, std::memory_order_relaxed);
+            return;
+        }
+        P_store_glyph(fnt, r.ch, g);
+    }
+}
+
+void font::prewarm(char32_t first, char32_t last)
+{
+    P_adopt_prewarmed(*this);
+
+    std::vector<char32_t> todo;
+    for (char32_t ch = first; ch <= last && ch >= first; ch++)
+    {
+        // characters missing from the face would only fill the pages with the same box.
+        if (P_find_glyph(*this, ch) == nullptr && FT_Get_Char_Index(P_pimpl->face_ptr, ch) != 0)
+            todo.push_back(ch);
+    }
+    if (todo.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(P_pimpl->worker_mutex);
+        P_pimpl->queued.insert(P_pimpl->queued.end(), todo.begin(), todo.end());
+    }
+    if (!P_pimpl->worker.joinable())
+        P_pimpl->worker = std::thread(P_prewarm_run, P_pimpl.get(), height, mode);
+    P_pimpl->worker_cv.notify_one();
+}
+
+// lay out the string at the origin, in one pass. the alignment only moves the whole, so it is applied afterwards.
+static void P_make_layout(font &fnt, const std::u32string &str, P_layout &lay)
+{
+    double scale = lay.scale;
+    double max_w = lay.max_w;
+    double h_scaled = scale * fnt.lspc;
+    long frame = clock::now().render_ticks;
+    double w = 0;
+    double lw = 0;
+    double h = 0;
+    double dx = 0;
+    double dy = 0;
+    int lns = 1;
+
+    auto touch = [&](const glyph &g) {
+        if (g.P_page < 0)
+            return;
+        fnt.P_pimpl->pages[g.P_page].last_use = frame;
+        if (std::find(lay.pages.begin(), lay.pages.end(), g.P_page) == lay.pages.end())
+            lay.pages.push_back(g.P_page);
+    };
+
+    for (size_t i = 0; i < str.length(); i++)
+    {
+        char32_t ch = str[i];
+        bool endln = ch == '\n';
+        const glyph *g = nullptr;
+
+        if (!endln)
+        {
+            g = &fnt.get_glyph(ch);
+            touch(*g);
+            // wrap, unless the glyph is the first on the line.
+            endln = dx > 0 && dx + g->advance * scale >= max_w;
+        }
+
+        if (endln)
+        {
+#ifdef ARC_Y_IS_DOWN
+            dy += h_scaled;
+#else
+            dy -= h_scaled;
+#endif
+            dx = 0;
+            w = std::max(w, lw);
+            lw = 0;
+            h += h_scaled;
+            lns++;
+            if (ch == '\n')
+                continue;
+        }
+
+        double adv = g->advance * scale;
+        lw += adv;
+        lay.quads.push_back({g->texpart, quad(dx + g->offset.x * scale, dy + g->offset.y * scale,
+                                              g->size.x * scale, g->size.y * scale)});
+        dx += adv;
+
+        // the last glyph on the line takes its width instead of its advance.
+        bool last = i == str.length() - 1 || str[i + 1] == '\n';
+        if (!last)
+        {
+            const glyph &next = fnt.get_glyph(str[i + 1]);
+            touch(next);
+            last = dx + next.advance * scale >= max_w;
+        }
+        if (last)
+            lw += g->size.x * scale - adv;
+    }
+
+    w = std::max(lw, w);
 #ifdef ARC_Y_IS_DOWN
-    g.offset.y = -face->glyph->metrics.horiBearingY / ds / 64.0 + height + face->bbox.yMin / ds / 64.0;
+    h += fnt.height * scale;
+    lay.bound = font_render_bound(quad::corner(0, 0, w, h), lw, lns);
 #else
-    g.offset.y = face->glyph->metrics.horiBearingY / ds / 64.0 - g.size.y;
+    h += fnt.height * scale;
+    lay.bound = font_render_bound(quad::corner(0, dy, w, h), lw, lns);
 #endif
 
-    return g;
+    // align the positions
+    double ax = 0, ay = 0;
+    if (lay.align & font_align::DOWN)
+        ay -= h;
+    if (lay.align & font_align::V_CENTER)
+        ay -= h / 2;
+    if (lay.align & font_align::RIGHT)
+        ax -= w;
+    if (lay.align & font_align::H_CENTER)
+        ax -= w / 2;
+    for (P_layout_quad &q : lay.quads)
+        q.dst.translate(ax, ay);
+    lay.bound.region.translate(ax, ay);
+}
+
+static uint64_t P_layout_key(const void *data, size_t len, bool wide, long align, double max_w, double scale)
+{
+    uint64_t k = io_hash64(data, len);
+    k ^= std::hash<double>()(scale) + 0x9e3779b97f4a7c15ULL + (k << 6) + (k >> 2);
+    k ^= std::hash<double>()(max_w) + 0x9e3779b97f4a7c15ULL + (k << 6) + (k >> 2);
+    k ^= static_cast<uint64_t>(align) * 2 + wide;
+    return k;
+}
+
+// find the cached layout, or make it. #str is only converted (or copied) when it is not cached.
+template <typename S>
+static P_layout &P_get_layout(font &fnt, const S &str, long align, double max_w, double scale)
+{
+    constexpr bool wide = std::is_same_v<S, std::u32string>;
+    const char *data = reinterpret_cast<const char *>(str.data());
+    size_t len = str.size() * sizeof(typename S::value_type);
+    font::P_impl *P_p = fnt.P_pimpl.get();
+    uint64_t key = P_layout_key(data, len, wide, align, max_w, scale);
+
+    auto it = P_p->layouts.find(key);
+    if (it != P_p->layouts.end())
+    {
+        P_layout &lay = it->second;
+        if (lay.epoch == P_p->epoch && lay.wide == wide && lay.align == align && lay.max_w == max_w &&
+            lay.scale == scale && lay.text.size() == len && std::memcmp(lay.text.data(), data, len) == 0)
+            return lay;
+        P_p->layouts.erase(it);
+    }
+
+    long frame = clock::now().render_ticks;
+    if (P_p->layouts.size() >= P_LAYOUT_CACHE_MAX)
+    {
+        std::erase_if(P_p->layouts, [&](const auto &e) { return e.second.last_use < frame; });
+        if (P_p->layouts.size() >= P_LAYOUT_CACHE_MAX)
+            P_p->layouts.clear();
+    }
+
+    P_layout lay;
+    lay.text.assign(data, len);
+    lay.wide = wide;
+    lay.align = align;
+    lay.max_w = max_w;
+    lay.scale = scale;
+    lay.last_use = frame;
+    if constexpr (wide)
+        P_make_layout(fnt, str, lay);
+    else
+    {
+        std::u32string u32;
+        P_cvt_u32(str, &u32);
+        P_make_layout(fnt, u32, lay);
+    }
+    // the epoch is taken after, since making the glyphs may have evicted pages not used by this layout.
+    lay.epoch = P_p->epoch;
+    return P_p->layouts[key] = std::move(lay);
+}
+
+static font_render_bound P_emit_layout(font &fnt, P_layout &lay, std::shared_ptr<brush> brush, double x, double y)
+{
+    font_render_bound bd = lay.bound;
+    bd.region.translate(x, y);
+    if (brush == nullptr)
+        return bd;
+
+    long frame = clock::now().render_ticks;
+    lay.last_use = frame;
+    for (int p : lay.pages)
+        fnt.P_pimpl->pages[p].last_use = frame;
+
+    // distance fields need their own program, unless the brush is given one.
+    bool sdf = fnt.mode == font_mode::SDF && brush->P_state.prog == nullptr;
+    if (sdf)
+        brush->use_program(program::make(builtin_program_type::SDF_TEXT));
+    for (const P_layout_quad &q : lay.quads)
+        brush->draw_texture(q.tex, quad(q.dst.x + x, q.dst.y + y, q.dst.width, q.dst.height));
+    if (sdf)
+        brush->use_program(nullptr);
+    return bd;
 }
 
 font_render_bound font::make_vtx(std::shared_ptr<brush> brush, const std::string &u8_str, double x, double y,
                                  long align, double max_w, double scale)
 {
-    static std::u32string P_cvtbuf;
-    P_cvt_u32(u8_str, &P_cvtbuf);
-    return make_vtx(brush, P_cvtbuf, x, y, align, max_w, scale);
+    if (u8_str.length() == 0 || u8_str.length() > INT16_MAX)
+        return {};
+    P_adopt_prewarmed(*this);
+    return P_emit_layout(*this, P_get_layout(*this, u8_str, align, max_w, scale), brush, x, y);
 }
 
 font_render_bound font::make_vtx(std::shared_ptr<brush> brush, const std::u32string &str, double x, double y,
@@ -102,92 +633,157 @@ font_render_bound font::make_vtx(std::shared_ptr<brush> brush, const std::u32str
 {
     if (str.length() == 0 || str.length() > INT16_MAX)
         return {};
+    P_adopt_prewarmed(*this);
+    return P_emit_layout(*this, P_get_layout(*this, str, align, max_w, scale), brush, x, y);
+}
 
-    if (align & font_align::LEFT && align & font_align::UP)
+void font::clear_layouts()
+{
+    P_pimpl->layouts.clear();
+}
+
+void font::save_cache()
+{
+    std::shared_ptr<asset_cache> cache = asset_cache_get();
+    if (cache == nullptr || P_pimpl->cache_name.empty())
+        return;
+
+    byte_buf buf;
+    buf.write<uint32_t>(static_cast<uint32_t>(P_pimpl->pages.size()));
+    for (P_glyph_page &page : P_pimpl->pages)
     {
-        double h_scaled = scale * lspc;
-        double w = 0;
-        double lw = 0;
-        double h = 0;
-        double lh = 0;
-        double dx = x;
-        double dy = y;
-        bool endln = false;
-        int lns = 1;
+        buf.write<uint32_t>(static_cast<uint32_t>(page.skyline.size()));
+        for (const P_skyline_node &n : page.skyline)
+        {
+            buf.write<int32_t>(n.x);
+            buf.write<int32_t>(n.y);
+            buf.write<int32_t>(n.width);
+        }
+        buf.write_bytes(page.img->pixels, static_cast<size_t>(page.img->width) * page.img->height * 4);
+    }
 
-        for (int i = 0; i < static_cast<int>(str.length()); i++)
+    uint32_t nglyphs = 0;
+    for (P_glyph_page &page : P_pimpl->pages)
+        nglyphs += static_cast<uint32_t>(page.glyphs.size());
+    buf.write<uint32_t>(nglyphs);
+    for (P_glyph_page &page : P_pimpl->pages)
+    {
+        for (char32_t ch : page.glyphs)
         {
-            char32_t ch = str[i];
+            const glyph &g = get_glyph(ch);
+            buf.write<uint32_t>(static_cast<uint32_t>(ch));
+            buf.write<int32_t>(g.P_page);
+            buf.write<int32_t>(g.texpart->u);
+            buf.write<int32_t>(g.texpart->v);
+            buf.write<int32_t>(g.texpart->width);
+            buf.write<int32_t>(g.texpart->height);
+            buf.write<double>(g.size.x);
+            buf.write<double>(g.size.y);
+            buf.write<double>(g.advance);
+            buf.write<double>(g.offset.x);
+            buf.write<double>(g.offset.y);
+        }
+    }
 
-            if (ch == '\n' || endln)
-            {
-#ifdef ARC_Y_IS_DOWN
-                dy += h_scaled;
-#else
-                dy -= h_scaled;
-#endif
-                dx = x;
-                endln = false;
-                w = std::max(w, lw);
-                lw = 0;
-                h += h_scaled;
-                lh = 0;
-                lns++;
-                continue;
-            }
+    cache->put(P_pimpl->cache_name, "glyphs", P_pimpl->file_hash, P_FONT_CACHE_VERSION, buf.to_vector());
+    P_pimpl->dirty = false;
+}
 
-            glyph g = get_glyph(ch) * scale;
+// a broken entry, start over and rasterize lazily.
+static bool P_drop_cache(font &fnt, font::P_impl *P_p)
+{
+    P_p->pages.clear();
+    for (std::unique_ptr<glyph[]> &blk : fnt.P_bmp)
+        blk = nullptr;
+    fnt.glyph_map.clear();
+    return false;
+}
+
+// restore the atlas pages and the glyphs from the cache, instead of rasterizing them again.
+static bool P_load_cache(font &fnt, font::P_impl *P_p)
+{
+    std::shared_ptr<asset_cache> cache = asset_cache_get();
+    if (cache == nullptr)
+        return false;
+    std::optional<asset_cache_blob> blob = cache->get(P_p->cache_name, "glyphs", P_p->file_hash, P_FONT_CACHE_VERSION);
+    if (!blob)
+        return false;
+
+    try
+    {
+        byte_buf buf = byte_buf(std::vector<uint8_t>(blob->data, blob->data + blob->size));
+        int ats = P_page_size(P_p);
 
-            if (dx - x + g.advance >= max_w)
+        uint32_t npages = buf.read<uint32_t>();
+        for (uint32_t i = 0; i < npages; i++)
+        {
+            std::vector<P_skyline_node> sky(buf.read<uint32_t>());
+            for (P_skyline_node &n : sky)
             {
-                endln = true;
-                i -= 1;
-                i = std::max(0, i - 1);
-                continue;
+                n.x = buf.read<int32_t>();
+                n.y = buf.read<int32_t>();
+                n.width = buf.read<int32_t>();
             }
 
-            lh = std::max(g.size.y, lh);
-            lw += g.advance;
-
-            if (brush != nullptr)
-                brush->draw_texture(g.texpart, {dx + g.offset.x, dy + g.offset.y, g.size.x, g.size.y});
-            dx += g.advance;
-
-            if (i == static_cast<int>(str.length()) - 1 || (get_glyph(str[i + 1]) * scale).advance + dx - x >= max_w)
-                lw += g.size.x - g.advance;
+            size_t len = static_cast<size_t>(ats) * ats * 4;
+            std::unique_ptr<uint8_t[]> pixels(new uint8_t[len]);
+            buf.read_bytes(pixels.get(), len);
+            P_p->pages.push_back(P_make_page(ats, pixels.release()));
+            P_p->pages.back().skyline = std::move(sky);
         }
 
-#ifdef ARC_Y_IS_DOWN
-        return font_render_bound(quad::corner(x, y, std::max(lw, w), h + height * scale), lw, lns);
-#else
-        return font_render_bound(quad::corner(x, dy, std::max(lw, w), h + f_height * scale), lw, lns);
-#endif
+        uint32_t nglyphs = buf.read<uint32_t>();
+        for (uint32_t i = 0; i < nglyphs; i++)
+        {
+            char32_t ch = static_cast<char32_t>(buf.read<uint32_t>());
+            int pi = buf.read<int32_t>();
+            int u = buf.read<int32_t>();
+            int v = buf.read<int32_t>();
+            int w = buf.read<int32_t>();
+            int h = buf.read<int32_t>();
+
+            glyph g;
+            g.size.x = buf.read<double>();
+            g.size.y = buf.read<double>();
+            g.advance = buf.read<double>();
+            g.offset.x = buf.read<double>();
+            g.offset.y = buf.read<double>();
+
+            if (pi < 0 || pi >= static_cast<int>(P_p->pages.size()))
+                return P_drop_cache(fnt, P_p);
+            P_glyph_page &page = P_p->pages[pi];
+            page.glyphs.push_back(ch);
+            g.texpart = page.tex->cut(quad(u, v, w, h));
+            g.P_page = pi;
+            P_store_glyph(fnt, ch, g);
+        }
     }
-
-    // align the positions
-    auto qd = make_vtx(nullptr, str, x, y, font_align::NORMAL, max_w, scale);
-    double w = qd.region.width, h = qd.region.height;
-
-    if (align & font_align::DOWN)
-        y -= h;
-    if (align & font_align::V_CENTER)
-        y -= h / 2;
-    if (align & font_align::RIGHT)
-        x -= w;
-    if (align & font_align::H_CENTER)
-        x -= w / 2;
-
-    return make_vtx(brush, str, x, y, font_align::NORMAL, max_w, scale);
+    catch (const std::exception &)
+    {
+        return P_drop_cache(fnt, P_p);
+    }
+    return true;
 }
 
-std::shared_ptr<font> font::load(const path_handle &path, double res_h, double pixel_h)
+std::shared_ptr<font> font::load(const path_handle &path, double res_h, double pixel_h, font_mode mode)
 {
     auto fptr = std::make_shared<font>();
+#ifndef P_FT_HAS_SDF
+    if (mode == font_mode::SDF)
+    {
+        print(ARC_WARN, "freetype is older than 2.11 and cannot render sdf glyphs, {} uses bitmaps.", path.abs_path);
+        mode = font_mode::BITMAP;
+    }
+#endif
+    fptr->mode = mode;
+
+    fptr->P_pimpl->file = io_read_bytes(path);
+    const std::vector<uint8_t> &file = fptr->P_pimpl->file;
 
     FT_LibraryRec_ *lib;
     FT_FaceRec_ *face;
     FT_Init_FreeType(&lib);
-    FT_New_Face(lib, path.abs_path.c_str(), 0, &face);
+    FT_New_Memory_Face(lib, file.data(), static_cast<FT_Long>(file.size()), 0, &face);
     FT_Select_Charmap(face, FT_ENCODING_UNICODE);
 
     fptr->P_pimpl->face_ptr = face;
@@ -199,6 +795,11 @@ std::shared_ptr<font> font::load(const path_handle &path, double res_h, double p
     fptr->descend = face->descender / 64.0;
     fptr->lspc = pixel_h + 1;
 
+    fptr->P_pimpl->file_hash = io_hash64(file.data(), file.size());
+    fptr->P_pimpl->cache_name =
+        fmt::format("{}@{}/{}{}", path.abs_path, res_h, pixel_h, mode == font_mode::SDF ? "/sdf" : "");
+    P_load_cache(*fptr, fptr->P_pimpl.get());
+
     return fptr;
 }
 
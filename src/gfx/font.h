@@ -22,21 +22,32 @@ struct font_align
     constexpr static long NORMAL_CENTER = H_CENTER | UP;
 };
 
+enum class font_mode
+{
+    // coverage bitmaps, sharp at the loaded resolution only.
+    BITMAP,
+    // signed distance fields. one rasterization stays sharp at any scale, and it is drawn with the sdf program.
+    SDF
+};
+
 struct glyph
 {
     std::shared_ptr<texture> texpart;
     vec2 size;
     double advance;
     vec2 offset;
+    // the atlas page it is on.
+    int P_page = -1;
 
     // scale the glyph.
-    inline glyph operator*(double scl)
+    inline glyph operator*(double scl) const
     {
         return {
             texpart,
             size * scl,
             advance * scl,
             offset * scl,
+            P_page,
         };
     }
 };
@@ -53,31 +64,64 @@ struct font
     struct P_impl;
     std::unique_ptr<P_impl> P_pimpl;
 
+    // the glyphs in the basic multilingual plane, in blocks of 256 made on first use,
+    // so a lookup is two indexings. a glyph without #texpart is not made yet.
+    std::unique_ptr<glyph[]> P_bmp[256];
+    // the glyphs out of the plane.
     std::unordered_map<char32_t, glyph> glyph_map;
     double height = 0;
     double lspc = 0;
     double ascend = 0;
     double descend = 0;
+    // the glyph pages are shared by all characters. when they are all full, the least recently drawn page
+    // is cleared for new glyphs, and the glyphs on it are rasterized again on their next use.
+    size_t max_pages = 8;
+    font_mode mode = font_mode::BITMAP;
 
     font();
     ~font();
 
-    glyph get_glyph(char32_t ch)
+    // the reference is valid until the glyph is evicted, which never happens to a glyph drawn in this frame.
+    const glyph &get_glyph(char32_t ch)
     {
-        if (glyph_map.find(ch) == glyph_map.end())
-            return glyph_map[ch] = make_glyph(ch);
-        return glyph_map[ch];
+        if (ch < 0x10000)
+        {
+            std::unique_ptr<glyph[]> &blk = P_bmp[ch >> 8];
+            if (blk == nullptr)
+                blk = std::make_unique<glyph[]>(256);
+            glyph &g = blk[ch & 0xff];
+            if (g.texpart == nullptr)
+                g = make_glyph(ch);
+            return g;
+        }
+        auto it = glyph_map.find(ch);
+        if (it == glyph_map.end())
+            it = glyph_map.emplace(ch, make_glyph(ch)).first;
+        return it->second;
     }
 
     glyph make_glyph(char32_t ch);
-    // draw the stringin the font, return the bounding box.
+    // rasterize the characters in [first, last] on a worker thread, so that their first use does not stall.
+    // they are placed on the pages over the next drawings, a few at a time, and only into free room: pre-warming never
+    // evicts glyphs or goes over #max_pages, and what does not fit is made on demand as usual.
+    void prewarm(char32_t first, char32_t last);
+    // write the rasterized glyphs to the asset cache, so the next launch can skip rasterizing them.
+    // it is called on destruction as well, if new glyphs were made.
+    void save_cache();
+    // draw the string in the font, return the bounding box.
     // and if brush is nullptr, it won't draw anything, just calculating the bounding box.
+    // the layout is cached by the string and the arguments but the position, so drawing the same text again
+    // only offsets the cached quads.
     font_render_bound make_vtx(std::shared_ptr<brush> brush, const std::string &str, double x, double y,
                                long align = font_align::NORMAL, double max_w = INT_MAX, double scale = 1);
     font_render_bound make_vtx(std::shared_ptr<brush> brush, const std::u32string &str, double x, double y,
                                long align = font_align::NORMAL, double max_w = INT_MAX, double scale = 1);
 
-    static std::shared_ptr<font> load(const path_handle &path, double res_h, double pixel_h);
+    // forget the cached layouts.
+    void clear_layouts();
+
+    static std::shared_ptr<font> load(const path_handle &path, double res_h, double pixel_h,
+                                      font_mode mode = font_mode::BITMAP);
 };
 
 } // namespace arc::gfx
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <core/cache.h>
 #include <core/io.h>
+#include <core/load.h>
 #include <core/log.h>
+#include <gfx/atlas.h>
 #include <gfx/brush.h>
 #include <gfx/image.h>
+#include <cstring>
 
 
 // clang-format off
@@ -40,6 +45,16 @@ std::shared_ptr<image> image::load(const path_handle &path)
     return img;
 }
 
+std::shared_ptr<image> image::decode(const uint8_t *data, size_t size)
+{
+    std::shared_ptr<image> img = std::make_shared<image>();
+    img->pixels = stbi_load_from_memory(data, static_cast<int>(size), &img->width, &img->height, nullptr, 4);
+    if (img->pixels == nullptr)
+        print_throw(ARC_FATAL, "cannot decode image: {}", stbi_failure_reason());
+    img->P_is_from_stb = true;
+    return img;
+}
+
 std::shared_ptr<image> image::make(int width, int height, uint8_t *data)
 {
     std::shared_ptr<image> img = std::make_shared<image>();
@@ -101,6 +116,7 @@ void texture::parameters(texture_parameters param)
 void texture::P_link_data(std::shared_ptr<image> img)
 {
     P_relying_image = img;
+    P_dirty_rects.clear();
     full_width = width = img->width;
     full_height = height = img->height;
 
@@ -113,6 +129,106 @@ void texture::P_link_data(std::shared_ptr<image> img)
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void texture::P_update(std::shared_ptr<image> img)
+{
+    std::shared_ptr<image> old = P_relying_image;
+    if (old == nullptr || old->pixels == nullptr || old->width != img->width || old->height != img->height)
+    {
+        P_link_data(img);
+        return;
+    }
+
+    const uint32_t *a = reinterpret_cast<const uint32_t *>(old->pixels);
+    const uint32_t *b = reinterpret_cast<const uint32_t *>(img->pixels);
+    int w = img->width;
+    int x0 = w, y0 = -1, x1 = -1, y1 = -1;
+
+    for (int y = 0; y < img->height; y++)
+    {
+        const uint32_t *ra = a + static_cast<size_t>(y) * w;
+        const uint32_t *rb = b + static_cast<size_t>(y) * w;
+        if (std::memcmp(ra, rb, w * 4) == 0)
+            continue;
+        if (y0 == -1)
+            y0 = y;
+        y1 = y;
+        for (int x = 0; x < x0; x++)
+        {
+            if (ra[x] != rb[x])
+            {
+                x0 = x;
+                break;
+            }
+        }
+        for (int x = w - 1; x > x1; x--)
+        {
+            if (ra[x] != rb[x])
+            {
+                x1 = x;
+                break;
+            }
+        }
+    }
+
+    P_relying_image = img;
+    // nothing changed.
+    if (y0 == -1)
+        return;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, P_texture_id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0 + 1, y1 - y0 + 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    img->pixels + (static_cast<size_t>(y0) * w + x0) * 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void texture::P_mark_dirty(const quad &region)
+{
+    texture *rt = this;
+    while (rt->root != nullptr)
+        rt = rt->root.get();
+    rt->P_dirty_rects.push_back(region);
+}
+
+void texture::P_upload_dirty()
+{
+    std::shared_ptr<image> img = P_relying_image;
+    if (P_dirty_rects.empty() || img == nullptr || img->pixels == nullptr)
+        return;
+
+    // upload the bounding box at once, unless it carries much more than the regions themselves.
+    double x0 = P_dirty_rects[0].x, y0 = P_dirty_rects[0].y, x1 = x0, y1 = y0;
+    double area = 0;
+    for (const quad &r : P_dirty_rects)
+    {
+        x0 = std::min(x0, r.x);
+        y0 = std::min(y0, r.y);
+        x1 = std::max(x1, r.x + r.width);
+        y1 = std::max(y1, r.y + r.height);
+        area += r.width * r.height;
+    }
+    if ((x1 - x0) * (y1 - y0) <= area * 2)
+        P_dirty_rects.assign(1, quad(x0, y0, x1 - x0, y1 - y0));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, P_texture_id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, img->width);
+    for (const quad &r : P_dirty_rects)
+    {
+        int x = static_cast<int>(r.x), y = static_cast<int>(r.y);
+        int w = static_cast<int>(r.width), h = static_cast<int>(r.height);
+        if (w <= 0 || h <= 0)
+            continue;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE,
+                        img->pixels + (static_cast<size_t>(y) * img->width + x) * 4);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    P_dirty_rects.clear();
+}
+
 std::shared_ptr<texture> texture::cut(const quad &src)
 {
     std::shared_ptr<texture> ntex = std::make_shared<texture>();
@@ -133,6 +249,11 @@ void texture::P_bind(int unit)
 {
     if (unit == 0)
         print_throw(ARC_FATAL, "cannot bind to texture unit 0, since it is reserved.");
+    texture *rt = this;
+    while (rt->root != nullptr)
+        rt = rt->root.get();
+    if (!rt->P_dirty_rects.empty())
+        rt->P_upload_dirty();
     glActiveTexture(GL_TEXTURE0 + unit);
     glBindTexture(GL_TEXTURE_2D, P_texture_id);
 }
@@ -222,4 +343,79 @@ void nine_patches::make_vtx(std::shared_ptr<brush> brush, const quad &dst) const
     brush->draw_texture(rb, quad(x2, y2, tw, th));
 }
 
+// bump it when the decoded image layout changes, so that the old cache entries are dropped.
+constexpr static uint32_t P_IMAGE_CACHE_VERSION = 1;
+
+// decode a png, or take its pixels from the asset cache if the source is unchanged.
+static std::shared_ptr<image> P_load_image(const asset_source &src, const unique_id &id)
+{
+    std::vector<uint8_t> bytes = src.read_bytes();
+    std::shared_ptr<asset_cache> cache = asset_cache_get();
+    if (cache == nullptr)
+        return image::decode(bytes.data(), bytes.size());
+
+    uint64_t hash = io_hash64(bytes.data(), bytes.size());
+    if (std::optional<asset_cache_blob> blob = cache->get(id.concat(), "rgba", hash, P_IMAGE_CACHE_VERSION))
+    {
+        byte_buf head = byte_buf(std::vector<uint8_t>(blob->data, blob->data + std::min<size_t>(blob->size, 8)));
+        if (head.size() == 8)
+        {
+            int w = head.read<int32_t>();
+            int h = head.read<int32_t>();
+            size_t len = static_cast<size_t>(w) * h * 4;
+            if (blob->size == 8 + len)
+            {
+                uint8_t *pixels = new uint8_t[len];
+                std::memcpy(pixels, blob->data + 8, len);
+                return image::make(w, h, pixels);
+            }
+        }
+    }
+
+    std::shared_ptr<image> img = image::decode(bytes.data(), bytes.size());
+    size_t len = static_cast<size_t>(img->width) * img->height * 4;
+    byte_buf out = byte_buf(8 + len);
+    out.write<int32_t>(img->width);
+    out.write<int32_t>(img->height);
+    out.write_bytes(img->pixels, len);
+    cache->put(id.concat(), "rgba", hash, P_IMAGE_CACHE_VERSION, out.to_vector());
+    return img;
+}
+
+// decoding runs on the workers, only the gl textures are created on the main thread.
+// this unit is linked whenever textures are used, so the equipments are always there with them.
+static bool P_image_equips_registered = []() {
+    asset_equip_register(asset_loader_equip::PNG_AS_TEXTURE, [](asset_loader &loader) {
+        // the commit runs in the loader's #next, so the loader outlives it.
+        loader.async_strategy_map[".png"] = [&loader](const asset_source &src,
+                                                      const unique_id &id) -> std::function<void()> {
+            std::shared_ptr<image> img = P_load_image(src, id);
+            return [img, id, &loader]() {
+                // on reload, update the texture in place, so its cuts and holders see the new pixels.
+                std::shared_ptr<texture> *old = res_find<std::shared_ptr<texture>>(id).get();
+                if (old != nullptr && *old != nullptr)
+                {
+                    if (!atlas_update_shared(*old, img))
+                        (*old)->P_update(img);
+                    return;
+                }
+
+                std::shared_ptr<texture> tex;
+                std::string tag = loader.atlas_tag != nullptr ? loader.atlas_tag(id) : std::string();
+                if (!tag.empty())
+                    tex = atlas_pack_shared(tag, img, loader.atlas_page_size);
+                res_put(id, tex != nullptr ? tex : texture::make(img));
+            };
+        };
+    });
+    asset_equip_register(asset_loader_equip::PNG_AS_IMAGE, [](asset_loader &loader) {
+        loader.async_strategy_map[".png"] = [](const asset_source &src,
+                                               const unique_id &id) -> std::function<void()> {
+            std::shared_ptr<image> img = P_load_image(src, id);
+            return [img, id]() { res_put(id, img); };
+        };
+    });
+    return true;
+}();
+
 } // namespace arc::gfx
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <core/def.h>
 #include <core/math.h>
 #include <core/io.h>
+#include <vector>
 
 namespace arc::gfx
 {
@@ -19,6 +20,8 @@ struct image
     ~image();
 
     static std::shared_ptr<image> load(const path_handle &path);
+    // decode an encoded image (like png) in memory.
+    static std::shared_ptr<image> decode(const uint8_t *data, size_t size);
     static std::shared_ptr<image> make(int width, int height, uint8_t *data);
 };
 
@@ -50,6 +53,8 @@ struct texture : std::enable_shared_from_this<texture>
     /* unstable */ unsigned int P_texture_id = 0;
     /* unstable */ bool P_is_framebuffer;
     std::shared_ptr<texture> root = nullptr;
+    // regions of the relying image changed since the last upload, kept on the root texture.
+    std::vector<quad> P_dirty_rects;
 
     ~texture();
 
@@ -57,6 +62,13 @@ struct texture : std::enable_shared_from_this<texture>
     void parameters(texture_parameters param);
     std::shared_ptr<texture> cut(const quad &src);
     void P_link_data(std::shared_ptr<image> img);
+    // replace the pixels in place, keeping the gl texture and every cut of it.
+    // if the size is unchanged, only the bounding box of the changed pixels is uploaded.
+    void P_update(std::shared_ptr<image> img);
+    // queue a changed region of the relying image. the queued regions are uploaded together
+    // when the texture is next bound to draw, so pixels written between two draws go up at once.
+    void P_mark_dirty(const quad &region);
+    void P_upload_dirty();
     void P_bind(int i);
 };
 
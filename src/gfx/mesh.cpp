@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <core/log.h>
+#include <cstring>
 #include <gfx/mesh.h>
 #include <gfx/buffer.h>
 #include <gfx/brush.h>
@@ -17,13 +20,107 @@ mesh::mesh()
     P_brush->P_mesh_root = this;
 }
 
+// the size of a ring part at first. it doubles when a frame does not fit.
+constexpr static size_t P_RING_PART_SIZE = 1 << 20;
+
 mesh::~mesh()
 {
+    for (void *&f : P_ring_fences)
+        if (f != nullptr)
+            glDeleteSync(static_cast<GLsync>(f));
+    if (P_ring_vbo != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, P_ring_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &P_ring_vbo);
+    }
     glDeleteVertexArrays(1, &P_vao);
     glDeleteBuffers(1, &P_vbo);
     glDeleteBuffers(1, &P_ebo);
 }
 
+static void P_wait_fence(void *&fence)
+{
+    if (fence == nullptr)
+        return;
+    GLsync sync = static_cast<GLsync>(fence);
+    while (true)
+    {
+        GLenum r = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED || r == GL_WAIT_FAILED)
+            break;
+    }
+    glDeleteSync(sync);
+    fence = nullptr;
+}
+
+// (re)create the ring with parts of #part_size, after the gpu is done with the old one.
+static void P_make_ring(mesh &msh, size_t part_size)
+{
+    for (void *&f : msh.P_ring_fences)
+        P_wait_fence(f);
+    if (msh.P_ring_vbo != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, msh.P_ring_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &msh.P_ring_vbo);
+    }
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &msh.P_ring_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, msh.P_ring_vbo);
+    glBufferStorage(GL_ARRAY_BUFFER, part_size * 3, nullptr, flags);
+    msh.P_ring_ptr = static_cast<uint8_t *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, part_size * 3, flags));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    msh.P_ring_part_size = part_size;
+    msh.P_ring_part = 0;
+    msh.P_ring_pos = 0;
+
+    if (msh.P_ring_ptr == nullptr)
+    {
+        print(ARC_WARN, "cannot map the vertex ring, streaming with buffer uploads instead.");
+        glDeleteBuffers(1, &msh.P_ring_vbo);
+        msh.P_ring_vbo = 0;
+        msh.P_ring_broken = true;
+    }
+}
+
+long mesh::P_stream_write(const uint8_t *data, size_t size, size_t stride)
+{
+    if (!P_is_direct || P_ring_broken || !GLEW_ARB_buffer_storage)
+        return -1;
+
+    size_t begin = P_ring_part_size * P_ring_part;
+    // the first vertex is given as an index, so the offset must be a multiple of the stride.
+    size_t at = (begin + P_ring_pos + stride - 1) / stride * stride;
+    if (P_ring_ptr == nullptr || at + size > begin + P_ring_part_size)
+    {
+        size_t part = std::max(P_ring_part_size, P_RING_PART_SIZE);
+        while (part < (P_ring_pos + size + stride) * 2)
+            part *= 2;
+        P_make_ring(*this, part);
+        if (P_ring_ptr == nullptr)
+            return -1;
+        begin = 0;
+        at = 0;
+    }
+
+    std::memcpy(P_ring_ptr + at, data, size);
+    P_ring_pos = at + size - begin;
+    return static_cast<long>(at / stride);
+}
+
+void mesh::P_stream_next()
+{
+    if (P_ring_ptr == nullptr)
+        return;
+    P_ring_fences[P_ring_part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    P_ring_part = (P_ring_part + 1) % 3;
+    P_ring_pos = 0;
+    P_wait_fence(P_ring_fences[P_ring_part]);
+}
+
 std::shared_ptr<brush> mesh::retry()
 {
     buffer->clear();
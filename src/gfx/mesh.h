@@ -1,5 +1,6 @@
 #pragma once
 #include <core/def.h>
+#include <cstdint>
 #include <gfx/buffer.h>
 #include <gfx/state.h>
 
@@ -17,6 +18,18 @@ struct mesh
     /* unstable */ unsigned int P_vao, P_vbo, P_ebo;
     /* unstable */ bool P_is_direct;
 
+    // the direct mesh streams its vertices through a persistently mapped ring of three parts, one per frame.
+    // a part is fenced when its frame ends, and waited for before it is written again, so the writes never
+    // stall on a buffer the gpu still reads. it needs ARB_buffer_storage.
+    /* unstable */ unsigned int P_ring_vbo = 0;
+    /* unstable */ uint8_t *P_ring_ptr = nullptr;
+    /* unstable */ size_t P_ring_part_size = 0;
+    /* unstable */ size_t P_ring_pos = 0;
+    /* unstable */ int P_ring_part = 0;
+    /* unstable */ void *P_ring_fences[3] = {};
+    // mapping failed once, do not try again.
+    /* unstable */ bool P_ring_broken = false;
+
     mesh();
     ~mesh();
     // clear the mesh and attempt to redraw it.
@@ -25,6 +38,11 @@ struct mesh
     void record();
     // draw the mesh with the brush. the brush should be direct-to-screen.
     void draw(std::shared_ptr<brush> gbrush);
+    // copy the vertices into the ring, and return the index of the first one, to draw from.
+    // returns -1 if there is no ring, then the vertices should be uploaded to #P_vbo instead.
+    long P_stream_write(const uint8_t *data, size_t size, size_t stride);
+    // fence the part written in this frame and move on to the next.
+    void P_stream_next();
 
     static std::shared_ptr<mesh> make();
 };
@@ -2,7 +2,10 @@
 #include <core/log.h>
 #include <gfx/shader.h>
 #include <core/math.h>
+#include <gfx/buffer.h>
 #include <gfx/color.h>
+#include <cstddef>
+#include <string>
 
 // clang-format off
 #include <gl/glew.h>
@@ -41,6 +44,11 @@ void shader_attrib::layout(shader_vertex_data_type size, int components, int str
     glVertexAttribPointer(P_attrib_id, components, type, normalize, stride, reinterpret_cast<void *>(offset));
 }
 
+void shader_attrib::divisor(int n)
+{
+    glVertexAttribDivisor(P_attrib_id, n);
+}
+
 shader_uniform::shader_uniform(unsigned int id) : P_uniform_id(id)
 {
 }
@@ -180,6 +188,78 @@ static const std::string P_dfrag_textured = "#version 330 core\n"
                                             "    fragColor = o_color * texture(u_tex, o_texCoord);\n"
                                             "}";
 
+static const std::string P_dfrag_sdf_text = "#version 330 core\n"
+                                            "in vec4 o_color;\n"
+                                            "in vec2 o_texCoord;\n"
+                                            "out vec4 fragColor;\n"
+                                            "uniform sampler2D u_tex;\n"
+                                            "void main() {\n"
+                                            "    float d = texture(u_tex, o_texCoord).a;\n"
+                                            "    float w = max(fwidth(d), 1e-4);\n"
+                                            "    float a = smoothstep(0.5 - w, 0.5 + w, d);\n"
+                                            "    fragColor = vec4(o_color.rgb, o_color.a * a);\n"
+                                            "}";
+
+// the texture index is passed flat, so that a quad reads a single texture.
+static const std::string P_dvert_multi_textured = "#version 330 core\n"
+                                                  "layout(location = 0) in vec2 i_position;\n"
+                                                  "layout(location = 1) in vec4 i_color;\n"
+                                                  "layout(location = 2) in vec2 i_texCoord;\n"
+                                                  "layout(location = 3) in float i_tex;\n"
+                                                  "out vec4 o_color;\n"
+                                                  "out vec2 o_texCoord;\n"
+                                                  "flat out int o_tex;\n"
+                                                  "uniform mat4 u_proj;\n"
+                                                  "void main() {\n"
+                                                  "    o_color = i_color;\n"
+                                                  "    o_texCoord = i_texCoord;\n"
+                                                  "    o_tex = int(i_tex + 0.5);\n"
+                                                  "    gl_Position = u_proj * vec4(i_position.x, i_position.y, 0.0, 1.0);\n"
+                                                  "}";
+
+// glsl 3.30 only indexes sampler arrays by constants, so the texture is picked by a branch.
+static std::string P_make_multi_textured_frag()
+{
+    std::string src = "#version 330 core\n"
+                      "in vec4 o_color;\n"
+                      "in vec2 o_texCoord;\n"
+                      "flat in int o_tex;\n"
+                      "out vec4 fragColor;\n";
+    src += "uniform sampler2D u_tex[" + std::to_string(MULTI_TEXTURE_MAX) + "];\n";
+    src += "void main() {\n"
+           "    vec4 c;\n";
+    for (int i = 0; i < MULTI_TEXTURE_MAX; i++)
+    {
+        std::string n = std::to_string(i);
+        src += i == 0 ? "    if (o_tex == 0) " : "    else if (o_tex == " + n + ") ";
+        src += "c = texture(u_tex[" + n + "], o_texCoord);\n";
+    }
+    src += "    else c = vec4(1.0);\n"
+           "    fragColor = o_color * c;\n"
+           "}";
+    return src;
+}
+
+// every attribute is per instance. the corner comes from the index, which is 0 1 3 1 2 3 in the shared quad indices,
+// and the corners are laid out as the quads of #brush::draw_texture.
+static const std::string P_dvert_sprites = "#version 330 core\n"
+                                           "layout(location = 0) in vec3 i_row0;\n"
+                                           "layout(location = 1) in vec3 i_row1;\n"
+                                           "layout(location = 2) in vec4 i_uv;\n"
+                                           "layout(location = 3) in vec4 i_color;\n"
+                                           "out vec4 o_color;\n"
+                                           "out vec2 o_texCoord;\n"
+                                           "uniform mat4 u_proj;\n"
+                                           "void main() {\n"
+                                           "    int id = gl_VertexID;\n"
+                                           "    float cy = id == 0 || id == 3 ? 1.0 : 0.0;\n"
+                                           "    vec3 c = vec3(id < 2 ? 1.0 : 0.0, cy, 1.0);\n"
+                                           "    vec2 p = vec2(dot(i_row0, c), dot(i_row1, c));\n"
+                                           "    o_color = i_color;\n"
+                                           "    o_texCoord = mix(i_uv.xw, i_uv.zy, c.xy);\n"
+                                           "    gl_Position = u_proj * vec4(p, 0.0, 1.0);\n"
+                                           "}";
+
 static const std::string P_dvert_colored = "#version 330 core\n"
                                            "layout(location = 0) in vec2 i_position;\n"
                                            "layout(location = 1) in vec4 i_color;\n"
@@ -197,30 +277,81 @@ static const std::string P_dfrag_colored = "#version 330 core\n"
                                            "    fragColor = o_color;\n"
                                            "}";
 
-static std::shared_ptr<program> P_builtin_colored = nullptr, P_builtin_textured = nullptr;
+#ifdef ARC_VERTEX_RGBA8
+constexpr static shader_vertex_data_type P_COLOR_TYPE = shader_vertex_data_type::BYTE;
+constexpr static bool P_COLOR_NORMALIZED = true;
+#else
+constexpr static shader_vertex_data_type P_COLOR_TYPE = shader_vertex_data_type::HALF_FLOAT;
+constexpr static bool P_COLOR_NORMALIZED = false;
+#endif
+
+static std::shared_ptr<program> P_builtin_colored = nullptr, P_builtin_textured = nullptr, P_builtin_sdf_text = nullptr,
+                                P_builtin_multi_textured = nullptr, P_builtin_sprite_instanced = nullptr;
 
 std::shared_ptr<program> program::make(builtin_program_type type)
 {
-    if (P_builtin_colored == nullptr || P_builtin_textured == nullptr)
+    if (P_builtin_colored == nullptr || P_builtin_textured == nullptr || P_builtin_sdf_text == nullptr ||
+        P_builtin_multi_textured == nullptr || P_builtin_sprite_instanced == nullptr)
     {
-        P_builtin_colored = program::make(P_dvert_colored, P_dfrag_colored, [](std::shared_ptr<program> program) {
-            program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 2, 16, 0);
-            program->get_attrib(1).layout(shader_vertex_data_type::HALF_FLOAT, 4, 16, 8);
+        auto setup_textured = [](std::shared_ptr<program> program) {
+            constexpr int stride = sizeof(vtx_textured);
+            program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 2, stride, offsetof(vtx_textured, x));
+            program->get_attrib(1).layout(P_COLOR_TYPE, 4, stride, offsetof(vtx_textured, col), P_COLOR_NORMALIZED);
+            program->get_attrib(2).layout(shader_vertex_data_type::FLOAT, 2, stride, offsetof(vtx_textured, u));
 
             if (program->cached_uniforms.size() > 0)
                 return;
-            program->cache_uniform("u_proj"); // 0
-        });
-        P_builtin_textured = program::make(P_dvert_textured, P_dfrag_textured, [](std::shared_ptr<program> program) {
-            program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 2, 24, 0);
-            program->get_attrib(1).layout(shader_vertex_data_type::HALF_FLOAT, 4, 24, 8);
-            program->get_attrib(2).layout(shader_vertex_data_type::FLOAT, 2, 24, 16);
+            program->cache_uniform("u_proj");                    // 0
+            program->cache_uniform("u_tex").set_texture_unit(1); // 1
+        };
+
+        P_builtin_colored = program::make(P_dvert_colored, P_dfrag_colored, [](std::shared_ptr<program> program) {
+            constexpr int stride = sizeof(vtx_colored);
+            program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 2, stride, offsetof(vtx_colored, x));
+            program->get_attrib(1).layout(P_COLOR_TYPE, 4, stride, offsetof(vtx_colored, col), P_COLOR_NORMALIZED);
 
             if (program->cached_uniforms.size() > 0)
                 return;
-            program->cache_uniform("u_proj");                    // 0
-            program->cache_uniform("u_tex").set_texture_unit(1); // 1
+            program->cache_uniform("u_proj"); // 0
         });
+        P_builtin_textured = program::make(P_dvert_textured, P_dfrag_textured, setup_textured);
+        P_builtin_sdf_text = program::make(P_dvert_textured, P_dfrag_sdf_text, setup_textured);
+        P_builtin_multi_textured = program::make(
+            P_dvert_multi_textured, P_make_multi_textured_frag(), [](std::shared_ptr<program> program) {
+                constexpr int stride = sizeof(vtx_multi_textured);
+                program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 2, stride,
+                                              offsetof(vtx_multi_textured, x));
+                program->get_attrib(1).layout(P_COLOR_TYPE, 4, stride, offsetof(vtx_multi_textured, col),
+                                              P_COLOR_NORMALIZED);
+                program->get_attrib(2).layout(shader_vertex_data_type::FLOAT, 2, stride,
+                                              offsetof(vtx_multi_textured, u));
+                program->get_attrib(3).layout(shader_vertex_data_type::FLOAT, 1, stride,
+                                              offsetof(vtx_multi_textured, tex));
+
+                if (program->cached_uniforms.size() > 0)
+                    return;
+                program->cache_uniform("u_proj"); // 0
+                for (int i = 0; i < MULTI_TEXTURE_MAX; i++)
+                    program->cache_uniform("u_tex[" + std::to_string(i) + "]").set_texture_unit(1 + i);
+            });
+        P_builtin_sprite_instanced = program::make(
+            P_dvert_sprites, P_dfrag_textured, [](std::shared_ptr<program> program) {
+                constexpr int stride = sizeof(sprite_instance);
+                program->get_attrib(0).layout(shader_vertex_data_type::FLOAT, 3, stride,
+                                              offsetof(sprite_instance, m00));
+                program->get_attrib(1).layout(shader_vertex_data_type::FLOAT, 3, stride,
+                                              offsetof(sprite_instance, m10));
+                program->get_attrib(2).layout(shader_vertex_data_type::FLOAT, 4, stride, offsetof(sprite_instance, u));
+                program->get_attrib(3).layout(P_COLOR_TYPE, 4, stride, offsetof(sprite_instance, col),
+                                              P_COLOR_NORMALIZED);
+                for (int i = 0; i < 4; i++)
+                    program->get_attrib(i).divisor(1);
+
+                if (program->cached_uniforms.size() > 0)
+                    return;
+                program->cache_uniform("u_proj");                    // 0
+                program->cache_uniform("u_tex").set_texture_unit(1); // 1
+            });
     }
     switch (type)
     {
@@ -228,6 +359,12 @@ std::shared_ptr<program> program::make(builtin_program_type type)
         return P_builtin_colored;
     case builtin_program_type::TEXTURED:
         return P_builtin_textured;
+    case builtin_program_type::SDF_TEXT:
+        return P_builtin_sdf_text;
+    case builtin_program_type::MULTI_TEXTURED:
+        return P_builtin_multi_textured;
+    case builtin_program_type::SPRITE_INSTANCED:
+        return P_builtin_sprite_instanced;
     }
     return nullptr;
 }
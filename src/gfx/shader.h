@@ -23,6 +23,8 @@ struct shader_attrib
     shader_attrib(unsigned int id);
 
     void layout(shader_vertex_data_type size, int components, int stride, int offset, bool normalize = false);
+    // advance the attribute once every #n instances instead of once per vertex, 0 for per vertex.
+    void divisor(int n);
 };
 
 struct shader_uniform
@@ -41,10 +43,20 @@ struct shader_uniform
     void set(const transform &v);
 };
 
+// how many textures a multi-textured batch binds at most. unit 0 is reserved, so they take the units 1 to 8,
+// within the 16 that any gl 3.3 fragment shader has.
+constexpr int MULTI_TEXTURE_MAX = 8;
+
 enum class builtin_program_type
 {
     TEXTURED,
-    COLORED
+    COLORED,
+    // textured, with the alpha read as a signed distance field.
+    SDF_TEXT,
+    // textured from one of the textures bound together, picked by the vertex. see #brush::use_multi_texture.
+    MULTI_TEXTURED,
+    // textured unit quads, one per #sprite_instance. see #brush::draw_sprites.
+    SPRITE_INSTANCED
 };
 
 struct program
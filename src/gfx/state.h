@@ -14,7 +14,8 @@ enum class graph_mode
     COLORED_QUAD = 3,
 
     // TEXTURED_TRIANGLE = 16, <-- not implemented yet
-    TEXTURED_QUAD = 17
+    TEXTURED_QUAD = 17,
+    MULTI_TEXTURED_QUAD = 18
 };
 
 struct brush_flag
@@ -30,10 +31,18 @@ enum class blend_mode
     ADDITIVE
 };
 
+// the textures bound together for a multi-textured batch, on the units from 1 on.
+// slots are only appended, so the index a vertex was written with stays valid.
+struct texture_set
+{
+    std::vector<std::shared_ptr<texture>> slots;
+};
+
 struct graph_state
 {
     graph_mode mode = graph_mode::TEXTURED_QUAD;
     std::shared_ptr<texture> texture = nullptr;
+    std::shared_ptr<texture_set> textures = nullptr;
     std::shared_ptr<program> prog = nullptr;
     std::function<void(std::shared_ptr<program> program)> callback_uniform;
 };
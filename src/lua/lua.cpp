@@ -1,13 +1,9 @@
-#include <audio/device.h>
 #include <core/id.h>
 #include <core/load.h>
 #include <core/math.h>
-#include <gfx/brush.h>
 #include <lua/lua.h>
 
 using namespace sol;
-using namespace arc::gfx;
-using namespace arc::audio;
 
 namespace arc::lua
 {
@@ -53,7 +49,7 @@ void lua_make_state()
         else
             error_msg = std::string("lua error: ") + std::string(desc);
 
-        print(ARC_WARN, error_msg);
+        print(ARC_WARN, "{}", error_msg);
         lua_pushstring(L, error_msg.c_str());
         return 1;
     });
@@ -85,7 +81,6 @@ lua_program lua_compile(const std::string &code)
     return lua.load(code);
 }
 
-extern void lua_bind_gfx(lua_state &lua);
 extern void lua_bind_math(lua_state &lua);
 extern void lua_bind_ecs(lua_state &lua);
 extern void lua_bind_asset(lua_state &lua);
@@ -101,7 +96,6 @@ void lua_bind_modules()
     lua_bind_math(lua);
     lua_bind_ecs(lua);
     lua_bind_asset(lua);
-    lua_bind_gfx(lua);
     lua_bind_tcodec(lua);
     lua_bind_net(lua);
 }
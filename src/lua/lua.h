@@ -4,7 +4,10 @@
 #define SOL_NO_DEBUG 1
 
 #include <core/def.h>
+#include <core/load.h>
 #include <core/log.h>
+#include <core/prof.h>
+#include <core/res.h>
 #include <sol/sol.hpp>
 
 namespace arc::lua
@@ -29,7 +32,12 @@ inline static auto lua_native = sol::no_constructor;
 
 lua_state &lua_get_gstate();
 void lua_make_state();
+// bind the core modules, which a headless server has as well.
 void lua_bind_modules();
+// bind arc.gfx and the gfx resources, it lives in the gfx library. call it after #lua_bind_modules.
+void lua_bind_gfx(lua_state &lua);
+// bind the audio resources, it lives in the audio library. call it after #lua_bind_modules.
+void lua_bind_audio(lua_state &lua);
 void lua_eval(const std::string &code);
 void lua_eval(lua_program &code);
 lua_program lua_compile(const std::string &code);
@@ -46,13 +54,14 @@ template <typename T> T lua_get(const std::string &key)
 
 template <typename... Args> lua_object lua_protected_call(const lua_function &func, Args &&...args)
 {
+    ARC_PROF_ZONE("lua_protected_call");
     auto result = func(std::forward<Args>(args)...);
 
     if (result.valid())
         return result;
 
     sol::error err = result;
-    print_throw(ARC_FATAL, err.what());
+    print_throw(ARC_FATAL, "{}", err.what());
     return result;
 }
 
@@ -61,6 +70,11 @@ template <typename... Args> decltype(auto) lua_combine(Args &&...args)
     return sol::overload(std::forward<Args>(args)...);
 }
 
+template <typename... Args> decltype(auto) lua_property(Args &&...args)
+{
+    return sol::property(std::forward<Args>(args)...);
+}
+
 template <typename T> lua_object lua_ref(T &&ptr)
 {
     return sol::make_object(lua_get_gstate(), std::ref(ptr));
@@ -74,6 +88,23 @@ lua_type<Class> lua_new_usertype(lua_table &tb, const std::string &name, Args &&
 
 lua_table lua_make_table();
 
+// arc.asset.<name>(id) looks a resource up by id, each call hashes the id.
+// arc.asset.find_<name>(id) resolves a handle once, and handle:get() is cheap enough for per-frame use.
+template <typename T> void lua_bind_res(lua_table &tb, const std::string &name)
+{
+    auto h_type = lua_new_usertype<res_handle<T>>(tb, name + "_handle", lua_native);
+    h_type["valid"] = &res_handle<T>::valid;
+    h_type["get"] = [](const res_handle<T> &h) {
+        T *v = h.get();
+        return v != nullptr ? *v : T{};
+    };
+
+    tb[name] = lua_combine([](const unique_id &id) { return fetch<T>(id); },
+                           [](const std::string &id) { return fetch<T>(id); });
+    tb["find_" + name] = lua_combine([](const unique_id &id) { return res_find<T>(id); },
+                                     [](const std::string &id) { return res_find<T>(id); });
+}
+
 template <typename T> lua_table lua_vector(const std::vector<T> vec)
 {
     return sol::as_table(vec);
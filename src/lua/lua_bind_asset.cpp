@@ -1,13 +1,7 @@
-#include <audio/device.h>
 #include <core/id.h>
 #include <core/load.h>
-#include <gfx/font.h>
-#include <gfx/image.h>
+#include <core/res.h>
 #include <lua/lua.h>
-#include <gfx/shader.h>
-
-using namespace arc::gfx;
-using namespace arc::audio;
 
 namespace arc::lua
 {
@@ -20,9 +14,9 @@ void lua_bind_asset(lua_state &lua)
     auto uid_type = lua_new_usertype<unique_id>(
         _n, "unique_id",
         lua_constructors<unique_id(const std::string &), unique_id(const std::string &, const std::string &)>());
-    uid_type["concat"] = &unique_id::concat;
-    uid_type["scope"] = &unique_id::scope;
-    uid_type["key"] = &unique_id::key;
+    uid_type["concat"] = lua_property([](const unique_id &id) { return id.concat(); });
+    uid_type["scope"] = lua_property([](const unique_id &id) { return std::string(id.scope()); });
+    uid_type["key"] = lua_property([](const unique_id &id) { return std::string(id.key()); });
     uid_type["P_hash"] = &unique_id::P_hash;
     uid_type["find_path"] = &unique_id::find_path;
     uid_type["__eq"] = &unique_id::operator==;
@@ -31,31 +25,37 @@ void lua_bind_asset(lua_state &lua)
     // asset_loader
     auto loader_type = lua_new_usertype<asset_loader>(_n, "asset_loader", lua_native);
     loader_type["scan"] = &asset_loader::scan;
+    loader_type["scan_pack"] = [](asset_loader &self, const path_handle &path) {
+        self.scan_pack(asset_pack::open(path));
+    };
     loader_type["next"] = &asset_loader::next;
     loader_type["add_sub"] = &asset_loader::add_sub;
+    loader_type["watch"] = &asset_loader::watch;
     loader_type["add_strategy"] = [](asset_loader &self, const std::string &fmt, const lua_function &f) {
         self.process_strategy_map[fmt] = [f](const path_handle &path, const unique_id &id) {
-            P_get_resource_map()[id] = lua_protected_call(f, path);
+            res_put(id, lua_protected_call(f, path));
+        };
+    };
+    loader_type["progress"] = &asset_loader::progress;
+    loader_type["priority"] = &asset_loader::priority;
+    loader_type["upload_budget"] = &asset_loader::upload_budget;
+    // f(id) returns the tag of a texture, or nil to keep it on its own.
+    loader_type["atlas_tag"] = [](asset_loader &self, const lua_function &f) {
+        self.atlas_tag = [f](const unique_id &id) {
+            lua_object tag = lua_protected_call(f, id);
+            return tag.is<std::string>() ? tag.as<std::string>() : std::string();
         };
     };
+    loader_type["atlas_page_size"] = &asset_loader::atlas_page_size;
     loader_type["make"] = &asset_loader::make;
 
     // asset_mapping
-    _n["has"] =
-        lua_combine([](const unique_id &id) { return P_get_resource_map().find(id) != P_get_resource_map().end(); },
-                    [](const std::string &id) { return P_get_resource_map().find(id) != P_get_resource_map().end(); });
-    _n["texture"] = lua_combine([](const unique_id &id) { return fetch<std::shared_ptr<texture>>(id); },
-                                [](const std::string &id) { return fetch<std::shared_ptr<texture>>(id); });
-    _n["track"] = lua_combine([](const unique_id &id) { return fetch<std::shared_ptr<track>>(id); },
-                              [](const std::string &id) { return fetch<std::shared_ptr<track>>(id); });
-    _n["font"] = lua_combine([](const unique_id &id) { return fetch<std::shared_ptr<font>>(id); },
-                             [](const std::string &id) { return fetch<std::shared_ptr<font>>(id); });
-    _n["image"] = lua_combine([](const unique_id &id) { return fetch<std::shared_ptr<image>>(id); },
-                              [](const std::string &id) { return fetch<std::shared_ptr<image>>(id); });
-    _n["program"] = lua_combine([](const unique_id &id) { return fetch<std::shared_ptr<program>>(id); },
-                                [](const std::string &id) { return fetch<std::shared_ptr<program>>(id); });
-    _n["text"] = lua_combine([](const unique_id &id) { return fetch<std::string>(id); },
-                             [](const std::string &id) { return fetch<std::string>(id); });
+    _n["has"] = lua_combine([](const unique_id &id) { return res_has(id); },
+                            [](const std::string &id) { return res_has(id); });
+    lua_bind_res<std::string>(_n, "text");
+    // what custom strategies return.
+    lua_bind_res<lua_object>(_n, "object");
+    // the gl & al resources are bound by #lua_bind_gfx and #lua_bind_audio.
 
     lua["arc"]["asset"] = _n;
 }
@@ -0,0 +1,15 @@
+#include <audio/device.h>
+#include <lua/lua.h>
+
+using namespace arc::audio;
+
+namespace arc::lua
+{
+
+void lua_bind_audio(lua_state &lua)
+{
+    lua_table asset_n = lua["arc"]["asset"];
+    lua_bind_res<std::shared_ptr<track>>(asset_n, "track");
+}
+
+} // namespace arc::lua
@@ -1,8 +1,8 @@
-#include <audio/device.h>
 #include <core/bin.h>
 #include <core/bio.h>
 #include <core/buffer.h>
 #include <core/io.h>
+#include <core/prof.h>
 #include <core/uuid.h>
 #include <lua/lua.h>
 
@@ -120,6 +120,14 @@ void lua_bind_base(lua_state &lua)
     uuid_type["__lt"] = &uuid::operator<;
 
     lua["arc"]["io"] = _n;
+
+    // profiler
+    auto prof_n = lua_make_table();
+    prof_n["set_enabled"] = &prof_set_enabled;
+    prof_n["is_enabled"] = &prof_is_enabled;
+    prof_n["clear"] = &prof_clear;
+    prof_n["export"] = &prof_export;
+    lua["arc"]["prof"] = prof_n;
 }
 
 } // namespace arc::lua
\ No newline at end of file
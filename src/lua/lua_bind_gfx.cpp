@@ -1,4 +1,3 @@
-#include <audio/device.h>
 #include <gfx/atlas.h>
 #include <gfx/brush.h>
 #include <gfx/device.h>
@@ -6,6 +5,7 @@
 #include <gfx/gui.h>
 #include <gfx/image.h>
 #include <gfx/mesh.h>
+#include <gfx/shader.h>
 #include <lua/lua.h>
 
 using namespace arc::gfx;
@@ -30,6 +30,10 @@ void lua_bind_gfx(lua_state &lua)
                     [](std::shared_ptr<brush> self, std::shared_ptr<texture> tex, const quad &dst) {
                         self->draw_texture(tex, dst);
                     });
+    brush_type["draw_sprites"] = [](std::shared_ptr<brush> self, std::shared_ptr<texture> tex,
+                                    const std::vector<sprite_instance> &sprites) {
+        self->draw_sprites(tex, sprites.data(), static_cast<int>(sprites.size()));
+    };
     brush_type["draw_rect"] = &brush::draw_rect;
     brush_type["draw_oval"] = &brush::draw_oval;
     brush_type["draw_rect_outline"] = &brush::draw_rect_outline;
@@ -56,11 +60,28 @@ void lua_bind_gfx(lua_state &lua)
     brush_type["use_program"] = &brush::use_program;
     brush_type["use_state"] = &brush::use_state;
     brush_type["use_blend"] = &brush::use_blend;
+    brush_type["use_multi_texture"] = &brush::use_multi_texture;
+    brush_type["bake_transform"] = &brush::bake_transform;
     brush_type["viewport"] = &brush::viewport;
     brush_type["scissor"] = &brush::scissor;
     brush_type["scissor_end"] = &brush::scissor_end;
+    brush_type["queue_begin"] = &brush::queue_begin;
+    brush_type["queue_end"] = &brush::queue_end;
+    brush_type["queue_layer"] = &brush::queue_layer;
+    brush_type["queue_sort_layer"] =
+        lua_combine([](std::shared_ptr<brush> self, int layer, bool sorted) { self->queue_sort_layer(layer, sorted); },
+                    [](std::shared_ptr<brush> self, int layer) { self->queue_sort_layer(layer); });
     brush_type["P_state"] = &brush::P_state;
 
+    // sprite instance
+    auto spr_type = lua_new_usertype<sprite_instance>(_n, "sprite_instance", lua_native);
+    spr_type["make"] = lua_combine(
+        [](const texture &tex, const quad &dst, const transform &t, const color &col) {
+            return sprite_instance::make(tex, dst, t, col);
+        },
+        [](const texture &tex, const quad &dst, const transform &t) { return sprite_instance::make(tex, dst, t); },
+        [](const texture &tex, const quad &dst) { return sprite_instance::make(tex, dst); });
+
     // color
     auto color_type = lua_new_usertype<color>(
         _n, "color", lua_constructors<color(), color(double, double, double), color(double, double, double, double)>());
@@ -120,6 +141,9 @@ void lua_bind_gfx(lua_state &lua)
     auto fnt_type = lua_new_usertype<font>(_n, "font", lua_native);
     fnt_type["height"] = &font::height;
     fnt_type["lspc"] = &font::lspc;
+    fnt_type["prewarm"] = [](font &self, long first, long last) {
+        self.prewarm(static_cast<char32_t>(first), static_cast<char32_t>(last));
+    };
     fnt_type["make_vtx"] = lua_combine(
         [](font &self, std::shared_ptr<brush> brush, const std::string &u8_str, double x, double y,
            long align, double max_w,
@@ -141,6 +165,12 @@ void lua_bind_gfx(lua_state &lua)
     fnt_align["V_CENTER"] = font_align::V_CENTER;
 
     lua["arc"]["gfx"] = _n;
+
+    lua_table asset_n = lua["arc"]["asset"];
+    lua_bind_res<std::shared_ptr<texture>>(asset_n, "texture");
+    lua_bind_res<std::shared_ptr<font>>(asset_n, "font");
+    lua_bind_res<std::shared_ptr<image>>(asset_n, "image");
+    lua_bind_res<std::shared_ptr<program>>(asset_n, "program");
 }
 
 } // namespace arc::lua
\ No newline at end of file
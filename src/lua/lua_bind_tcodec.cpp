@@ -1,4 +1,3 @@
-#include <audio/device.h>
 #include <core/bin.h>
 #include <core/bio.h>
 #include <core/io.h>
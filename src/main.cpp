@@ -7,6 +7,7 @@
 #include <core/io.h>
 #include <core/load.h>
 #include <core/log.h>
+#include <core/prof.h>
 #include <core/rand.h>
 #include <core/uuid.h>
 #include <gfx/atlas.h>
@@ -76,10 +77,12 @@ int main()
     fnt = font::load(io_open_local("gfx/font/main.ttf"), 32, 12);
     auto tex = texture::make(image::load(io_open_local("gfx/misc/test.png")));
     pct = nine_patches(tex);
-    P_get_resource_map()["arcaie:gfx/misc/test.png"] = tex;
+    res_put(unique_id("arcaie:gfx/misc/test.png"), tex);
 
     lua_make_state();
     lua_bind_modules();
+    lua_bind_gfx(lua_get_gstate());
+    lua_bind_audio(lua_get_gstate());
     lua_eval(io_read_str(io_open_local("main.lua")));
     packet::mark_id<packet_2s_heartbeat>();
     packet::mark_id<packet_dummy>();
@@ -129,12 +132,14 @@ int main()
         brush->clear({0, 0, 0, 1});
         brush->use_camera(camera::normal());
         brush->use_blend(blend_mode::NORMAL);
+        brush->queue_begin();
         gui::tick_currents();
         gui::render_currents(brush);
 
         brush->use_camera(camera::gui());
         fnt->make_vtx(brush, "DEBUG FPS: " + std::to_string(tk_real_fps()), 15, 15);
         lua_protected_call(lua_get<lua_function>("draw"), brush);
+        brush->queue_end();
     });
 
     tk_make_device();
@@ -146,6 +151,10 @@ int main()
 
     tk_lifecycle(60, 20, false);
 
+#ifdef ARC_PROFILE
+    prof_export(io_open_local("trace.json"));
+#endif
+
     sockc.disconnect();
     socks.stop();
 
@@ -1,7 +1,6 @@
 #include <core/buffer.h>
 #include <core/io.h>
 #include <net/packet.h>
-#include <net/socket.h>
 
 namespace arc::net
 {
@@ -52,29 +51,6 @@ std::shared_ptr<packet> packet::unpack(byte_buf &buffer, int len)
     return p;
 }
 
-void packet::send_to_server()
-{
-    socket::remote().send_to_server(shared_from_this());
-}
-
-void packet::send_to_remote(const uuid &rid)
-{
-    socket::server().send_to_remote(rid, shared_from_this());
-}
-
-void packet::send_to_remotes(const std::vector<uuid> &rids)
-{
-    auto ptr = shared_from_this();
-    auto &skt = socket::server();
-    for (auto &r : rids)
-        skt.send_to_remote(r, ptr);
-}
-
-void packet::send_to_remotes()
-{
-    socket::server().send_to_remotes(shared_from_this());
-}
-
 static int P_pid_counter_v;
 static std::unordered_map<int, std::function<std::shared_ptr<packet>()>> P_pmap_v;
 static std::unordered_map<size_t, int> P_pmap_rev_v;
@@ -3,6 +3,7 @@
 #include <core/def.h>
 #include <core/uuid.h>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 
@@ -101,7 +102,7 @@ struct packet_dummy : packet
 
     void perform(packet_context *) override
     {
-        print(ARC_DEBUG, str);
+        print(ARC_DEBUG, "{}", str);
     }
 };
 #endif
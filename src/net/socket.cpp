@@ -1,7 +1,7 @@
 #include <core/buffer.h>
+#include <core/prof.h>
 #include <core/time.h>
 #include <fmt/format.h>
-#include <gfx/device.h>
 #include <net/socket.h>
 
 #include <queue>
@@ -544,6 +544,7 @@ void socket::send_to_remotes(std::shared_ptr<packet> pkt)
 
 void socket::tick()
 {
+    ARC_PROF_ZONE("socket::tick");
     P_pimpl->tick(this);
 }
 
@@ -564,6 +565,30 @@ socket &socket::remote()
     return P_remote;
 }
 
+// kept here rather than in packet.cpp, so that packing does not depend on the sockets.
+void packet::send_to_server()
+{
+    socket::remote().send_to_server(shared_from_this());
+}
+
+void packet::send_to_remote(const uuid &rid)
+{
+    socket::server().send_to_remote(rid, shared_from_this());
+}
+
+void packet::send_to_remotes(const std::vector<uuid> &rids)
+{
+    auto ptr = shared_from_this();
+    auto &skt = socket::server();
+    for (auto &r : rids)
+        skt.send_to_remote(r, ptr);
+}
+
+void packet::send_to_remotes()
+{
+    socket::server().send_to_remotes(shared_from_this());
+}
+
 uint16_t P_gen_tcp_port()
 {
     asio::io_context ioc;
@@ -576,7 +601,7 @@ uint16_t P_gen_tcp_port()
     }
     catch (const std::exception &e)
     {
-        print_throw(ARC_FATAL, e.what());
+        print_throw(ARC_FATAL, "{}", e.what());
     }
     return s.local_endpoint().port();
 }
@@ -593,7 +618,7 @@ uint16_t P_gen_udp_port()
     }
     catch (const std::exception &e)
     {
-        print_throw(ARC_FATAL, e.what());
+        print_throw(ARC_FATAL, "{}", e.what());
     }
     return s.local_endpoint().port();
 }
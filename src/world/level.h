@@ -2,6 +2,7 @@
 #include <core/def.h>
 #include <core/ecs.h>
 #include <core/math.h>
+#include <core/prof.h>
 #include <functional>
 #include <core/uuid.h>
 
@@ -67,12 +68,14 @@ struct level
 
     void tick_phase(ecs_phase ph)
     {
+        ARC_PROF_ZONE("tick_phase");
         for (auto &sys : P_ecs_syses[static_cast<int>(ph)])
             sys(*this);
     }
 
     void tick_systems()
     {
+        ARC_PROF_ZONE("tick_systems");
         tick_phase(ecs_phase::PRE);
         tick_phase(ecs_phase::COMMON);
         tick_phase(ecs_phase::POST);
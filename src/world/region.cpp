@@ -0,0 +1,371 @@
+#include <core/bio.h>
+#include <core/buffer.h>
+#include <core/log.h>
+#include <world/region.h>
+#include <cstdio>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define P_REGION_MAGIC 0x52435241u // "ARCR"
+#define P_REGION_VERSION 1u
+#define P_REGION_SLOTS (ARC_REGION_SIZE * ARC_REGION_SIZE)
+#define P_REGION_META_BYTES 32
+#define P_REGION_SLOT_BYTES 12
+#define P_REGION_HEADER_BYTES (P_REGION_META_BYTES + P_REGION_SLOTS * P_REGION_SLOT_BYTES)
+#define P_REGION_HEADER_SECTORS ((P_REGION_HEADER_BYTES + ARC_REGION_SECTOR_BYTES - 1) / ARC_REGION_SECTOR_BYTES)
+
+namespace arc::world
+{
+
+static void P_seek(std::FILE *f, uint64_t off)
+{
+#ifdef _WIN32
+    int rc = _fseeki64(f, static_cast<long long>(off), SEEK_SET);
+#else
+    int rc = fseeko(f, static_cast<off_t>(off), SEEK_SET);
+#endif
+    if (rc != 0)
+        print_throw(ARC_FATAL, "region seek failed at {}", off);
+}
+
+// push the written bytes down to the disk, so that the write order is kept after a crash.
+static void P_sync(std::FILE *f)
+{
+    std::fflush(f);
+#ifdef _WIN32
+    _commit(_fileno(f));
+#else
+    fsync(fileno(f));
+#endif
+}
+
+static uint32_t P_fnv1a(const uint8_t *data, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int P_slot_index(int lx, int ly)
+{
+    if (lx < 0 || ly < 0 || lx >= ARC_REGION_SIZE || ly >= ARC_REGION_SIZE)
+        print_throw(ARC_FATAL, "chunk ({}, {}) is out of the region.", lx, ly);
+    return ly * ARC_REGION_SIZE + lx;
+}
+
+region_file::~region_file()
+{
+    if (P_file != nullptr)
+        std::fclose(P_file);
+}
+
+bool region_file::has(int lx, int ly)
+{
+    std::lock_guard<std::mutex> lock(P_mutex);
+    return P_slots[P_slot_index(lx, ly)].count != 0;
+}
+
+std::vector<uint8_t> region_file::read(int lx, int ly)
+{
+    P_slot slot;
+    std::vector<uint8_t> blob;
+
+    {
+        std::lock_guard<std::mutex> lock(P_mutex);
+        slot = P_slots[P_slot_index(lx, ly)];
+        if (slot.count == 0)
+            return {};
+        blob.resize(slot.length);
+        P_seek(P_file, static_cast<uint64_t>(slot.sector) * ARC_REGION_SECTOR_BYTES);
+        if (std::fread(blob.data(), 1, slot.length, P_file) != slot.length)
+            print_throw(ARC_FATAL, "short read of chunk ({}, {}) in {}", lx, ly, path.abs_path);
+    }
+
+    // decompress outside the lock, it may be slow.
+    if (static_cast<region_codec>(slot.codec) == region_codec::BROTLI)
+        return io_decompress(std::move(blob));
+    return blob;
+}
+
+void region_file::write(int lx, int ly, std::vector<uint8_t> data, region_codec codec)
+{
+    int idx = P_slot_index(lx, ly);
+
+    // compress outside the lock, it may be slow.
+    std::vector<uint8_t> blob;
+    switch (codec)
+    {
+    case region_codec::NO:
+        blob = std::move(data);
+        break;
+    case region_codec::BROTLI:
+        blob = io_compress(std::move(data), io_compression_level::OPTIMAL);
+        break;
+    default:
+        print_throw(ARC_FATAL, "unsupported region codec {}", static_cast<int>(codec));
+    }
+
+    if (blob.empty())
+    {
+        remove(lx, ly);
+        return;
+    }
+
+    // the header records the unpadded length, which is what #read returns.
+    size_t data_len = blob.size();
+    uint32_t count = static_cast<uint32_t>((data_len + ARC_REGION_SECTOR_BYTES - 1) / ARC_REGION_SECTOR_BYTES);
+    if (count > UINT16_MAX)
+        print_throw(ARC_FATAL, "chunk ({}, {}) is too large to be stored in a region.", lx, ly);
+    // pad to whole sectors so that the file always ends at a sector boundary.
+    blob.resize(static_cast<size_t>(count) * ARC_REGION_SECTOR_BYTES);
+
+    std::lock_guard<std::mutex> lock(P_mutex);
+
+    P_slot old = P_slots[idx];
+    uint32_t sector = P_alloc(count);
+
+    P_seek(P_file, static_cast<uint64_t>(sector) * ARC_REGION_SECTOR_BYTES);
+    if (std::fwrite(blob.data(), 1, blob.size(), P_file) != blob.size())
+        print_throw(ARC_FATAL, "short write of chunk ({}, {}) in {}", lx, ly, path.abs_path);
+    P_sync(P_file);
+
+    P_slot &slot = P_slots[idx];
+    slot.sector = sector;
+    slot.count = static_cast<uint16_t>(count);
+    slot.codec = static_cast<uint8_t>(codec);
+    slot.length = static_cast<uint32_t>(data_len);
+    P_commit_header();
+
+    // only now the old sectors are unreferenced, and can be reused.
+    P_mark(old, false);
+    P_mark(slot, true);
+}
+
+void region_file::remove(int lx, int ly)
+{
+    std::lock_guard<std::mutex> lock(P_mutex);
+    P_slot old = P_slots[P_slot_index(lx, ly)];
+    if (old.count == 0)
+        return;
+    P_slots[P_slot_index(lx, ly)] = P_slot();
+    P_commit_header();
+    P_mark(old, false);
+}
+
+binary_map region_file::read_map(int lx, int ly)
+{
+    std::vector<uint8_t> data = read(lx, ly);
+    if (data.empty())
+        return {};
+    byte_buf buf = byte_buf(data);
+    return bio_read_buf(buf);
+}
+
+void region_file::write_map(int lx, int ly, const binary_map &map, region_codec codec)
+{
+    write(lx, ly, bio_write_buf(map).to_vector(), codec);
+}
+
+void region_file::P_load_header()
+{
+    uint64_t best_gen = 0;
+    int best = -1;
+    std::vector<P_slot> best_slots;
+
+    for (int copy = 0; copy < 2; copy++)
+    {
+        byte_buf buf = byte_buf(P_REGION_HEADER_BYTES);
+        P_seek(P_file, static_cast<uint64_t>(copy) * P_REGION_HEADER_SECTORS * ARC_REGION_SECTOR_BYTES);
+        if (std::fread(buf.P_data.data(), 1, P_REGION_HEADER_BYTES, P_file) != P_REGION_HEADER_BYTES)
+            continue;
+        buf.set_write_pos(P_REGION_HEADER_BYTES);
+
+        uint32_t magic = buf.read<uint32_t>();
+        uint32_t version = buf.read<uint32_t>();
+        uint64_t gen = buf.read<uint64_t>();
+        uint32_t checksum = buf.read<uint32_t>();
+        uint32_t nslots = buf.read<uint32_t>();
+        buf.set_read_pos(P_REGION_META_BYTES);
+
+        if (magic != P_REGION_MAGIC || version != P_REGION_VERSION || nslots != P_REGION_SLOTS)
+            continue;
+        if (checksum != P_fnv1a(buf.P_data.data() + P_REGION_META_BYTES, P_REGION_SLOTS * P_REGION_SLOT_BYTES))
+            continue;
+        if (best != -1 && gen <= best_gen)
+            continue;
+
+        std::vector<P_slot> slots(P_REGION_SLOTS);
+        for (auto &s : slots)
+        {
+            s.sector = buf.read<uint32_t>();
+            s.count = buf.read<uint16_t>();
+            s.codec = buf.read<uint8_t>();
+            s.P_reserved = buf.read<uint8_t>();
+            s.length = buf.read<uint32_t>();
+        }
+
+        best = copy;
+        best_gen = gen;
+        best_slots = std::move(slots);
+    }
+
+    P_used.assign(2 * P_REGION_HEADER_SECTORS, true);
+
+    if (best == -1)
+    {
+        // a new (or totally broken) file, start from an empty table.
+        P_slots.assign(P_REGION_SLOTS, P_slot());
+        P_generation = 0;
+        P_active = 1;
+        P_commit_header();
+        return;
+    }
+
+    P_slots = std::move(best_slots);
+    P_generation = best_gen;
+    P_active = best;
+    for (auto &s : P_slots)
+        P_mark(s, true);
+}
+
+void region_file::P_commit_header()
+{
+    byte_buf buf = byte_buf(P_REGION_HEADER_BYTES);
+    buf.set_write_pos(P_REGION_META_BYTES);
+    for (auto &s : P_slots)
+    {
+        buf.write<uint32_t>(s.sector);
+        buf.write<uint16_t>(s.count);
+        buf.write<uint8_t>(s.codec);
+        buf.write<uint8_t>(s.P_reserved);
+        buf.write<uint32_t>(s.length);
+    }
+
+    uint32_t checksum = P_fnv1a(buf.P_data.data() + P_REGION_META_BYTES, P_REGION_SLOTS * P_REGION_SLOT_BYTES);
+    buf.set_write_pos(0);
+    buf.write<uint32_t>(P_REGION_MAGIC);
+    buf.write<uint32_t>(P_REGION_VERSION);
+    buf.write<uint64_t>(P_generation + 1);
+    buf.write<uint32_t>(checksum);
+    buf.write<uint32_t>(P_REGION_SLOTS);
+
+    // always overwrite the older copy, the newer one stays intact until this one is synced.
+    int target = 1 - P_active;
+    P_seek(P_file, static_cast<uint64_t>(target) * P_REGION_HEADER_SECTORS * ARC_REGION_SECTOR_BYTES);
+    buf.P_data.resize(P_REGION_HEADER_SECTORS * ARC_REGION_SECTOR_BYTES);
+    if (std::fwrite(buf.P_data.data(), 1, buf.P_data.size(), P_file) != buf.P_data.size())
+        print_throw(ARC_FATAL, "short write of region header in {}", path.abs_path);
+    P_sync(P_file);
+
+    P_generation++;
+    P_active = target;
+}
+
+uint32_t region_file::P_alloc(uint32_t count)
+{
+    // first-fit over the free sectors, or append to the end.
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < P_used.size(); i++)
+    {
+        run = P_used[i] ? 0 : run + 1;
+        if (run == count)
+            return i + 1 - count;
+    }
+    return static_cast<uint32_t>(P_used.size()) - run;
+}
+
+void region_file::P_mark(const P_slot &slot, bool used)
+{
+    if (slot.count == 0)
+        return;
+    if (P_used.size() < slot.sector + slot.count)
+        P_used.resize(slot.sector + slot.count, false);
+    for (uint32_t i = slot.sector; i < slot.sector + slot.count; i++)
+        P_used[i] = used;
+}
+
+std::shared_ptr<region_file> region_file::open(const path_handle &path)
+{
+    std::shared_ptr<region_file> rf = std::make_shared<region_file>();
+    rf->path = path;
+
+    if (!io_exists(path))
+        io_mkdirs(path);
+    rf->P_file = std::fopen(path.abs_path.c_str(), io_exists(path) ? "r+b" : "w+b");
+    if (rf->P_file == nullptr)
+        print_throw(ARC_FATAL, "cannot open region {}", path.abs_path);
+
+    rf->P_load_header();
+    return rf;
+}
+
+int region_of(int c)
+{
+    return c >= 0 ? c / ARC_REGION_SIZE : (c + 1) / ARC_REGION_SIZE - 1;
+}
+
+int region_local(int c)
+{
+    return c - region_of(c) * ARC_REGION_SIZE;
+}
+
+std::shared_ptr<region_file> region_storage::find(int cx, int cy)
+{
+    int rx = region_of(cx), ry = region_of(cy);
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(rx)) << 32) | static_cast<uint32_t>(ry);
+
+    std::lock_guard<std::mutex> lock(P_mutex);
+    auto it = P_files.find(key);
+    if (it != P_files.end())
+        return it->second;
+    return P_files[key] = region_file::open(dir / fmt::format("r.{}.{}.arr", rx, ry));
+}
+
+bool region_storage::has(int cx, int cy)
+{
+    return find(cx, cy)->has(region_local(cx), region_local(cy));
+}
+
+std::vector<uint8_t> region_storage::read(int cx, int cy)
+{
+    return find(cx, cy)->read(region_local(cx), region_local(cy));
+}
+
+void region_storage::write(int cx, int cy, std::vector<uint8_t> data, region_codec codec)
+{
+    find(cx, cy)->write(region_local(cx), region_local(cy), std::move(data), codec);
+}
+
+binary_map region_storage::read_map(int cx, int cy)
+{
+    return find(cx, cy)->read_map(region_local(cx), region_local(cy));
+}
+
+void region_storage::write_map(int cx, int cy, const binary_map &map, region_codec codec)
+{
+    find(cx, cy)->write_map(region_local(cx), region_local(cy), map, codec);
+}
+
+void region_storage::close()
+{
+    std::lock_guard<std::mutex> lock(P_mutex);
+    P_files.clear();
+}
+
+std::shared_ptr<region_storage> region_storage::make(const path_handle &dir)
+{
+    std::shared_ptr<region_storage> rs = std::make_shared<region_storage>();
+    rs->dir = dir;
+    return rs;
+}
+
+} // namespace arc::world
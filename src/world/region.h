@@ -0,0 +1,105 @@
+#pragma once
+#include <core/bin.h>
+#include <core/def.h>
+#include <core/io.h>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// a region holds ARC_REGION_SIZE x ARC_REGION_SIZE chunks.
+#define ARC_REGION_SIZE 32
+#define ARC_REGION_SECTOR_BYTES 4096
+
+namespace arc::world
+{
+
+enum class region_codec : uint8_t
+{
+    NO = 0,
+    BROTLI = 1
+};
+
+// a random-access chunk storage file.
+//
+// layout:
+// [header A][header B][sectors...]
+// each header is a slot table (one slot per chunk) with a generation and a checksum.
+// a chunk blob is compressed on its own and occupies whole sectors, so reading or saving one chunk
+// never touches other chunks.
+//
+// crash-safety:
+// a new blob is always written into sectors that the committed header does not refer to,
+// then the older header copy is overwritten with generation + 1. if we crash in between,
+// the other copy is still valid and points to the old data. freed sectors are reused by later saves.
+//
+// all methods are guarded by a mutex, so a save can run on a background thread while the
+// game thread reads other chunks. pass a serialized snapshot (not a live object) to #write.
+struct region_file
+{
+    struct P_slot
+    {
+        uint32_t sector = 0;
+        uint16_t count = 0;
+        uint8_t codec = 0;
+        uint8_t P_reserved = 0;
+        uint32_t length = 0;
+    };
+
+    path_handle path;
+    std::FILE *P_file = nullptr;
+    std::vector<P_slot> P_slots;
+    // true if the sector is referenced by the committed header (or is a header sector).
+    std::vector<bool> P_used;
+    uint64_t P_generation = 0;
+    // which header copy holds #P_generation (0 = A, 1 = B).
+    int P_active = 0;
+    std::mutex P_mutex;
+
+    region_file() = default;
+    region_file(const region_file &) = delete;
+    region_file &operator=(const region_file &) = delete;
+    ~region_file();
+
+    // lx and ly are local chunk coordinates, in [0, ARC_REGION_SIZE).
+    bool has(int lx, int ly);
+    // returns the decompressed chunk bytes, or an empty vector if the chunk is absent.
+    std::vector<uint8_t> read(int lx, int ly);
+    void write(int lx, int ly, std::vector<uint8_t> data, region_codec codec = region_codec::BROTLI);
+    void remove(int lx, int ly);
+    binary_map read_map(int lx, int ly);
+    void write_map(int lx, int ly, const binary_map &map, region_codec codec = region_codec::BROTLI);
+
+    void P_load_header();
+    void P_commit_header();
+    uint32_t P_alloc(uint32_t count);
+    void P_mark(const P_slot &slot, bool used);
+
+    static std::shared_ptr<region_file> open(const path_handle &path);
+};
+
+// maps chunk coordinates to region files under a directory, opening them lazily.
+struct region_storage
+{
+    path_handle dir;
+    std::unordered_map<uint64_t, std::shared_ptr<region_file>> P_files;
+    std::mutex P_mutex;
+
+    std::shared_ptr<region_file> find(int cx, int cy);
+    bool has(int cx, int cy);
+    std::vector<uint8_t> read(int cx, int cy);
+    void write(int cx, int cy, std::vector<uint8_t> data, region_codec codec = region_codec::BROTLI);
+    binary_map read_map(int cx, int cy);
+    void write_map(int cx, int cy, const binary_map &map, region_codec codec = region_codec::BROTLI);
+    // close all opened region files.
+    void close();
+
+    static std::shared_ptr<region_storage> make(const path_handle &dir);
+};
+
+// get the region coordinate of a chunk coordinate (floored).
+int region_of(int c);
+// get the local coordinate of a chunk coordinate inside its region.
+int region_local(int c);
+
+} // namespace arc::world
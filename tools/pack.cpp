@@ -0,0 +1,43 @@
+#include <core/io.h>
+#include <core/log.h>
+#include <core/pack.h>
+#include <cstring>
+#include <fmt/format.h>
+
+using namespace arc;
+
+// usage: arcaie-pack <root> <out> [--store]
+// packs every file under <root> into the archive <out>. --store disables compression.
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fmt::print("usage: arcaie-pack <root> <out> [--store]\n");
+        return 1;
+    }
+
+    bool compress = !(argc > 3 && std::strcmp(argv[3], "--store") == 0);
+    path_handle root = io_open(fs::absolute(argv[1]).string());
+    path_handle out = io_open(fs::absolute(argv[2]).string());
+
+    try
+    {
+        asset_pack_write(root, out, compress);
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print("failed: {}\n", e.what());
+        return 1;
+    }
+
+    std::shared_ptr<asset_pack> pack = asset_pack::open(out);
+    uint64_t stored = 0;
+    uint64_t raw = 0;
+    for (auto &e : pack->entries)
+    {
+        stored += e.size;
+        raw += e.raw_size;
+    }
+    fmt::print("packed {} files, {} -> {} bytes: {}\n", pack->entries.size(), raw, stored, out.abs_path);
+    return 0;
+}